@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "archive.h"
+
+
+static int writeU64(FILE *file, uint64_t value) {
+    uint8_t buffer[8];
+    for (int i = 0; i < 8; i++) {
+        buffer[i] = value >> (i * 8);
+    }
+    return fwrite(buffer, 1, 8, file) != 8;
+}
+
+static uint64_t readU64(const uint8_t *data) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)data[i] << (i * 8);
+    }
+    return value;
+}
+
+int openArchiveWriter(ArchiveWriter *w, const char *path) {
+    w->file = fopen(path, "wb");
+    if (w->file == NULL) {
+        perror("Error opening archive");
+        return 1;
+    }
+    w->offset = ArchiveHeaderSize;
+    w->offsets = NULL;
+    w->count = 0;
+    w->capacity = 0;
+
+    uint8_t version = ArchiveVersion;
+    if (
+        fwrite(ArchiveMagic, 1, ArchiveMagicSize, w->file) != ArchiveMagicSize ||
+        fwrite(&version, 1, 1, w->file) != 1
+    ) {
+        perror("Error writing archive header");
+        fclose(w->file);
+        w->file = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+int appendArchiveReplay(ArchiveWriter *w, const uint8_t *data, size_t size) {
+    if (w->count == w->capacity) {
+        size_t capacity = w->capacity ? w->capacity * 2 : 1024;
+        uint64_t *temp = realloc(w->offsets, capacity * sizeof(uint64_t));
+        if (temp == NULL) return 1;
+        w->offsets = temp;
+        w->capacity = capacity;
+    }
+
+    if (fwrite(data, 1, size, w->file) != size) {
+        perror("Error writing archive");
+        return 1;
+    }
+    w->offsets[w->count++] = w->offset;
+    w->offset += size;
+    return 0;
+}
+
+int closeArchiveWriter(ArchiveWriter *w) {
+    int error = 0;
+    uint64_t indexOffset = w->offset;
+    for (size_t i = 0; i < w->count; i++) {
+        error |= writeU64(w->file, w->offsets[i]);
+    }
+    error |= writeU64(w->file, w->offset);
+    error |= writeU64(w->file, indexOffset);
+    error |= writeU64(w->file, w->count);
+    error |= fwrite(ArchiveIndexMagic, 1, ArchiveMagicSize, w->file) != ArchiveMagicSize;
+
+    if (fclose(w->file) != 0) error = 1;
+    w->file = NULL;
+    free(w->offsets);
+    w->offsets = NULL;
+    if (error) perror("Error writing archive");
+    return error;
+}
+
+int openArchive(Archive *a, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        perror("Error opening archive");
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < ArchiveHeaderSize + ArchiveFooterSize) {
+        fprintf(stderr, "Error: archive too small\n");
+        close(fd);
+        return 1;
+    }
+
+    a->size = st.st_size;
+    void *map = mmap(NULL, a->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error mapping archive");
+        return 1;
+    }
+    a->data = map;
+
+    const uint8_t *footer = a->data + a->size - ArchiveFooterSize;
+    uint64_t indexOffset = readU64(footer);
+    uint64_t count = readU64(footer + 8);
+    uint64_t indexEnd = a->size - ArchiveFooterSize;
+    if (
+        memcmp(a->data, ArchiveMagic, ArchiveMagicSize) != 0 ||
+        a->data[ArchiveMagicSize] != ArchiveVersion ||
+        memcmp(footer + 16, ArchiveIndexMagic, ArchiveMagicSize) != 0 ||
+        indexOffset > indexEnd ||
+        count >= (indexEnd - indexOffset) / 8
+    ) {
+        fprintf(stderr, "Error: not an archive file\n");
+        closeArchive(a);
+        return 1;
+    }
+
+    a->index = a->data + indexOffset;
+    a->count = count;
+    return 0;
+}
+
+int getArchiveReplay(const Archive *a, size_t i, const uint8_t **data, size_t *size) {
+    if (i >= a->count) return 1;
+    uint64_t start = readU64(a->index + i * 8);
+    uint64_t end = readU64(a->index + (i + 1) * 8);
+    if (start > end || end > (uint64_t)(a->index - a->data)) return 1;
+
+    *data = a->data + start;
+    *size = end - start;
+    return 0;
+}
+
+void closeArchive(Archive *a) {
+    munmap((void*)a->data, a->size);
+    a->data = NULL;
+    a->index = NULL;
+    a->count = 0;
+}
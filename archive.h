@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+
+// File layout:
+//   "TRAR" version:u8
+//   replays, concatenated
+//   index: count * offset:u64, then the end offset of the last replay:u64
+//   footer: indexOffset:u64 count:u64 "TRAX"
+// Integers are little endian. Replay i spans index[i] .. index[i + 1].
+#define ArchiveMagic      "TRAR"
+#define ArchiveIndexMagic "TRAX"
+#define ArchiveMagicSize  4
+#define ArchiveVersion    1
+#define ArchiveHeaderSize (ArchiveMagicSize + 1)
+#define ArchiveFooterSize 20
+
+typedef struct {
+    FILE *file;
+    uint64_t offset;
+    uint64_t *offsets;
+    size_t count;
+    size_t capacity;
+} ArchiveWriter;
+
+typedef struct {
+    const uint8_t *data; // read only mapping of the whole file
+    size_t size;
+    const uint8_t *index;
+    size_t count;
+} Archive;
+
+
+int openArchiveWriter(ArchiveWriter *w, const char *path);
+int appendArchiveReplay(ArchiveWriter *w, const uint8_t *data, size_t size);
+int closeArchiveWriter(ArchiveWriter *w);
+
+int openArchive(Archive *a, const char *path);
+int getArchiveReplay(const Archive *a, size_t i, const uint8_t **data, size_t *size);
+void closeArchive(Archive *a);
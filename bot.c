@@ -0,0 +1,86 @@
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "bot.h"
+
+
+// Weights from https://codemyroad.wordpress.com/2013/04/14/tetris-ai-the-near-perfect-player/
+#define WeightHeight    -0.510066
+#define WeightLines      0.760666
+#define WeightHoles     -0.35663
+#define WeightBumpiness -0.184483
+
+static double evaluate(const GameState *state, int lines) {
+    if (state->gameOver) return -1e9;
+
+    int heights[GAME_WIDTH];
+    int holes = 0;
+    for (int x = 0; x < GAME_WIDTH; x++) {
+        heights[x] = 0;
+        for (int y = 0; y < GAME_HEIGHT; y++) {
+            bool filled = state->map[y * GAME_WIDTH + x];
+            if (filled && heights[x] == 0) {
+                heights[x] = GAME_HEIGHT - y;
+            } else if (!filled && heights[x] != 0) {
+                holes++;
+            }
+        }
+    }
+
+    int height = 0;
+    int bumpiness = 0;
+    for (int x = 0; x < GAME_WIDTH; x++) {
+        height += heights[x];
+        if (x > 0) bumpiness += abs(heights[x] - heights[x - 1]);
+    }
+
+    return WeightHeight * height + WeightLines * lines +
+        WeightHoles * holes + WeightBumpiness * bumpiness;
+}
+
+// Rotates, pushes the piece against the left wall, then moves right to placement.x
+static void movePiece(GameState *state, Placement placement) {
+    for (int i = 0; i < placement.rotation; i++) {
+        rotate(state);
+    }
+    for (int i = 0; i < GAME_WIDTH; i++) {
+        moveLeft(state);
+    }
+    for (int i = 0; i < placement.x; i++) {
+        int x = state->x;
+        moveRight(state);
+        if (state->x == x) break;
+    }
+}
+
+Placement choosePlacement(const GameState *state) {
+    Placement best = { 0, state->x };
+    double bestValue = -1e18;
+
+    for (int rotation = 0; rotation < 4; rotation++) {
+        for (int x = 0; x < GAME_WIDTH; x++) {
+            Placement placement = { rotation, x };
+            GameState copy = *state;
+            movePiece(&copy, placement);
+            // Blocked moves land on an already tried column
+            if (copy.x != x) break;
+
+            while (!copy.gameOver && !updateGame(&copy)) {}
+            double value = evaluate(&copy, copy.score - state->score);
+            if (value > bestValue) {
+                bestValue = value;
+                best = placement;
+            }
+        }
+    }
+    return best;
+}
+
+/* @return Lines cleared */
+int playPlacement(GameState *state, Placement placement) {
+    int score = state->score;
+    movePiece(state, placement);
+    while (!state->gameOver && !updateGame(state)) {}
+    return state->score - score;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "game.h"
+
+
+// Where the bot drops the active piece: rotations applied from spawn and the
+// resulting column after moving
+typedef struct {
+    int rotation;
+    int x;
+} Placement;
+
+Placement choosePlacement(const GameState *state);
+int playPlacement(GameState *state, Placement placement);
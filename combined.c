@@ -1,9 +1,19 @@
 #include <time.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#ifndef _WIN32
+    #include <unistd.h>
+    #include <sys/eventfd.h>
+#endif
 
 #include "game.h"
+#include "replay.h"
+#include "repeat.h"
+#include "handoff.h"
 
 // windows.h and raylib.h use common names
 #define Rectangle WinRectangle
@@ -14,6 +24,7 @@
 #define DrawTextEx WinDrawTextEx
 #define PlaySound WinPlaySound
 #include "terminal/renderer.h"
+#include "view.h"
 #undef Rectangle
 #undef CloseWindow
 #undef ShowCursor
@@ -23,300 +34,318 @@
 #undef PlaySound
 
 #include "terminal/input.h"
+#include "terminal/events.h"
+#include "terminal/trace.h"
+#include "display.h"
+#include "gui-view.h"
+#include "gui-input.h"
 #include "raylib.h"
 
 
-#define TileSize 20
 #define WIDTH (GAME_WIDTH + 20) * TileSize
 #define HEIGHT (GAME_HEIGHT + 6) * TileSize
 
 typedef struct {
-    clock_t start;
-    clock_t end;
-} Clock;
-bool clockTick(Clock *c, int limit) {
-    c->end = clock();
-    double elapsed_ms = (double)(c->end - c->start) * 1000 / CLOCKS_PER_SEC;
-    if (elapsed_ms >= limit) {
-        c->start = c->end;
-        return true;
-    }
-    return false;
+    DisplayList scene;
+    DisplayList score;
+} Frame;
+
+void buildFrame(Frame *frame, const GameState *state) {
+    initDisplayList(&frame->scene);
+    buildGameScene(&frame->scene, state);
+    initDisplayList(&frame->score);
+    buildScoreScene(&frame->score, state);
 }
 
-// https://en.wikipedia.org/wiki/List_of_Unicode_characters#Box_Drawing
-const CharacterNT C_Hash = "▒"; // 	█ ▓ ▒ ░
-const CharacterNT C_Space = " ";
-const CharacterNT C_Pipe = "│";
-const CharacterNT C_Dash = "─";
-const CharacterNT C_BoxTL = "┌";
-const CharacterNT C_BoxTR = "┐";
-const CharacterNT C_BoxBL = "└";
-const CharacterNT C_BoxBR = "┘";
-const Renderer_Color Terminal_BoxColor = Color_White;
-const Renderer_Color Terminal_PieceColor[NumberOfPieces] = {
-    Color_Red,
-    Color_Green,
-    Color_Yellow,
-    Color_Blue,
-    Color_Magenta,
-    Color_Cyan,
-    Color_White
-};
-
-const Color GUI_BoxColor = WHITE;
-const Color GUI_PieceColor[NumberOfPieces] = {
-    RED,
-    GREEN,
-    YELLOW,
-    BLUE,
-    MAGENTA,
-    SKYBLUE,
-    RAYWHITE
-};
+void drawFrameTerminal(Renderer *r, const Frame *frame) {
+    Viewport screen = getViewport(r, 0, 0, r->width, r->height);
+    Viewport scene = getViewport(r,
+        (r->width - GAME_WIDTH) / 2 - SceneBoardX,
+        (r->height - GAME_HEIGHT) / 2 - SceneBoardY,
+        SceneWidth, SceneHeight
+    );
+    drawDisplayList(&screen, &frame->score);
+    drawDisplayList(&scene, &frame->scene);
+    draw(r);
+}
 
+void drawFrameGUI(const Frame *frame) {
+    int gameX = (WIDTH - GAME_WIDTH * TileSize) / 2;
+    int gameY = (HEIGHT - GAME_HEIGHT * TileSize) / 2;
+    drawDisplayListGUI(&frame->score, 0, 0);
+    drawDisplayListGUI(&frame->scene, gameX - SceneBoardX * TileSize, gameY - SceneBoardY * TileSize);
+}
+
+
+#define UpdateDelay  1000
+#define DrawAllDelay 1000
+// Longest the simulation sleeps without eventfd, window keys wait this long
+#define GUIPollDelay 4
+#define GUIQueueSize 64
+
+// Shared by the three threads: the window on the main thread, the
+// simulation and the terminal. Only the simulation touches the GameState,
+// the others draw its latest snapshot at their own pace.
 typedef struct {
+    atomic_bool quit;
+
+    // Window keys to the simulation, single producer single consumer
+    GUIKeyEvent guiKeys[GUIQueueSize];
+    atomic_uint guiHead; // next to pop
+    atomic_uint guiTail; // next to push
+    int guiWakeFd;       // eventfd the simulation waits on, -1 on Windows
+
+    StateHandoff terminalState;
+    StateHandoff windowState;
+
+    // Only to sleep the terminal thread until there is a new state
+    pthread_mutex_t terminalLock;
+    pthread_cond_t terminalWake;
+    bool terminalPending;
+
+    GameState start;
     Renderer *r;
-    int offx;
-    int offy;
-} Terminal_DrawPieceContext;
-void drawPieceCallbackTerminal(void *vCtx, int pieceIndex, int x, int y) {
-    Terminal_DrawPieceContext *ctx = (Terminal_DrawPieceContext*)vCtx;
-    setChar(ctx->r,
-        ctx->offx + x,
-        ctx->offy + y,
-        C_Hash,
-        Terminal_PieceColor[pieceIndex]
-    );
+} Shared;
+
+static void wakeTerminal(Shared *s) {
+    pthread_mutex_lock(&s->terminalLock);
+    s->terminalPending = true;
+    pthread_cond_signal(&s->terminalWake);
+    pthread_mutex_unlock(&s->terminalLock);
 }
 
-typedef struct {
-    int offx;
-    int offy;
-} GUI_DrawPieceContext;
-void drawPieceCallbackGUI(void *vCtx, int pieceIndex, int x, int y) {
-    GUI_DrawPieceContext *ctx = (GUI_DrawPieceContext*)vCtx;
-    DrawRectangle(
-        ctx->offx + x * TileSize,
-        ctx->offy + y * TileSize,
-        TileSize, TileSize,
-        GUI_PieceColor[pieceIndex]
-    );
+static void wakeSimulation(Shared *s) {
+    #ifndef _WIN32
+        uint64_t one = 1;
+        write(s->guiWakeFd, &one, sizeof(one));
+    #endif
 }
 
-void drawPieceTerminal(Renderer *r, int offx, int offy, int pieceIndex, int rotation) {
-    Terminal_DrawPieceContext ctx = {
-        .r = r,
-        .offx = offx,
-        .offy = offy
-    };
-    getPieceDrawInfo(pieceIndex, rotation, &drawPieceCallbackTerminal, &ctx);
+/* Keys past the queue capacity are dropped, the simulation empties it far
+ * more often than the window fills it */
+static void pushGUIKey(Shared *s, const GUIKeyEvent *event) {
+    unsigned tail = atomic_load_explicit(&s->guiTail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&s->guiHead, memory_order_acquire) == GUIQueueSize) return;
+    s->guiKeys[tail % GUIQueueSize] = *event;
+    atomic_store_explicit(&s->guiTail, tail + 1, memory_order_release);
 }
 
-void drawPieceGUI(int offx, int offy, int pieceIndex, int rotation) {
-    GUI_DrawPieceContext ctx = {
-        .offx = offx,
-        .offy = offy
-    };
-    getPieceDrawInfo(pieceIndex, rotation, &drawPieceCallbackGUI, &ctx);
+static bool popGUIKey(Shared *s, GUIKeyEvent *event) {
+    unsigned head = atomic_load_explicit(&s->guiHead, memory_order_relaxed);
+    if (head == atomic_load_explicit(&s->guiTail, memory_order_acquire)) return false;
+    *event = s->guiKeys[head % GUIQueueSize];
+    atomic_store_explicit(&s->guiHead, head + 1, memory_order_release);
+    return true;
 }
 
-void drawBox(Renderer *r, int offx, int offy, int width, int height) {
-    for (int y = 0; y < height; y++) {
-        setChar(r, offx        , offy + y, C_Pipe, Terminal_BoxColor);
-        setChar(r, offx + width, offy + y, C_Pipe, Terminal_BoxColor);
-    }
-    for (int x = 0; x < width; x++) {
-        setChar(r, offx + x, offy         , C_Dash, Terminal_BoxColor);
-        setChar(r, offx + x, offy + height, C_Dash, Terminal_BoxColor);
+static void playRepeats(KeyRepeat *repeat, GameState *state, uint64_t until) {
+    ReplayEventType move;
+    while ((move = nextRepeatMove(repeat, state, until)) != Replay_End) {
+        applyReplayEvent(state, move);
     }
-
-    setChar(r, offx        , offy         , C_BoxTL, Terminal_BoxColor);
-    setChar(r, offx + width, offy         , C_BoxTR, Terminal_BoxColor);
-    setChar(r, offx        , offy + height, C_BoxBL, Terminal_BoxColor);
-    setChar(r, offx + width, offy + height, C_BoxBR, Terminal_BoxColor);
 }
 
-void drawGameTerminal(Renderer *r, GameState *state) {
-    int gameX = (r->width - GAME_WIDTH) / 2;
-    int gameY = (r->height - GAME_HEIGHT) / 2;
-
-    // Game Map
-    for (int i = 0; i < GAME_WIDTH * GAME_HEIGHT; i++) {
-        int x = i % GAME_WIDTH;
-        int y = i / GAME_WIDTH;
-        setChar(r,
-            gameX + x,
-            gameY + y,
-            state->map[i] ? C_Hash : C_Space,
-            Color_Bright_Black
-        );
+/* Input and gravity, never waits on either frontend. Terminal keys play as
+ * taps, the terminal repeats them itself; window keys repeat through the
+ * engine from the times the window sampled them. */
+static void *runSimulation(void *arg) {
+    Shared *s = arg;
+    TRACE_THREAD("simulation");
+    GameState state = s->start;
+    GameState published = state;
+
+    KeyRepeat repeat;
+    initKeyRepeat(&repeat, (RepeatConfig){ .das = DefaultDas, .arr = DefaultArr, .dropArr = DefaultDropArr });
+
+    EventLoop loop;
+    if (initEventLoop(&loop, getInputFd(), s->guiWakeFd) != 0) {
+        atomic_store(&s->quit, true);
+        wakeTerminal(s);
+        return NULL;
     }
 
-    // Active piece
-    drawPieceTerminal(r, gameX + state->x, gameY + state->y, state->pieceIndex, state->rotation);
+    // Fixed steps, a late wakeup does not push later ticks back
+    uint64_t nextUpdate = monotonicMs() + UpdateDelay;
+    while (!atomic_load(&s->quit)) {
+        uint64_t deadline = nextRepeatTime(&repeat, &state, monotonicMs());
+        if (deadline > nextUpdate) deadline = nextUpdate;
+        if (s->guiWakeFd == -1 && deadline > monotonicMs() + GUIPollDelay) {
+            deadline = monotonicMs() + GUIPollDelay;
+        }
+        int events = waitEvents(&loop, deadline);
+        if (events & Event_Extra) {
+            uint64_t count;
+            read(s->guiWakeFd, &count, sizeof(count));
+        }
 
-    // Game Box
-    drawBox(r, gameX - 1, gameY - 1, GAME_WIDTH + 1, GAME_HEIGHT + 1);
+        TRACE_BEGIN("input");
+        Key chr;
+        getChar(&chr);
+        while (chr != NoKey) {
+            switch (chr) {
+                case KESC  : atomic_store(&s->quit, true); break;
+                case KLEFT : moveLeft(&state); break;
+                case KRIGHT: moveRight(&state); break;
+                case KUP   : rotate(&state); break;
+                case KDOWN : moveDown(&state); break;
+                default: break;
+            }
+            getChar(&chr);
+        }
 
-    int nextPieceX = gameX + GAME_WIDTH + 3;
-    // Clear next piece area
-    for (int y = 0; y < 6; y++) {
-        for (int x = 0; x < 8; x++) {
-            setChar(r, nextPieceX - 1 + x, gameY - 1 + y, " ", Color_Reset);
+        GUIKeyEvent event;
+        while (popGUIKey(s, &event)) {
+            playRepeats(&repeat, &state, event.time);
+            playGUIKey(&repeat, &state, &event);
         }
-    }
+        TRACE_END("input");
+
+        TRACE_BEGIN("update");
+        uint64_t now = monotonicMs();
+        playRepeats(&repeat, &state, now);
+        if (now >= nextUpdate) {
+            nextUpdate += UpdateDelay;
+            updateGame(&state);
+        }
+        TRACE_END("update");
 
-    // New Piece Box
-    drawBox(r,
-        nextPieceX - 1,
-        gameY - 1,
-        getWidthOfPiece(state->nextPieceIndex, 0) + 3,
-        getHeightOfPiece(state->nextPieceIndex, 0) + 3
-    );
+        if (memcmp(&state, &published, sizeof(GameState)) != 0) {
+            published = state;
+            publishHandoff(&s->terminalState, &state);
+            publishHandoff(&s->windowState, &state);
+            wakeTerminal(s);
+        }
+    }
+    // The terminal thread may be asleep when the quit comes from a key
+    wakeTerminal(s);
 
-    // Next piece
-    drawPieceTerminal(r, nextPieceX + 1, gameY + 1, state->nextPieceIndex, 0);
+    deinitEventLoop(&loop);
+    return NULL;
 }
 
-void drawGameGUI(GameState *state) {
-    int gameX = (WIDTH - GAME_WIDTH * TileSize) / 2;
-    int gameY = (HEIGHT - GAME_HEIGHT * TileSize) / 2;
-
-    // Game Box
-    DrawRectangleLines(
-        gameX - 2,
-        gameY - 2,
-        GAME_WIDTH * TileSize + 4,
-        GAME_HEIGHT * TileSize + 4,
-        GUI_BoxColor
-    );
-
-    // Game Map
-    for (int i = 0; i < GAME_WIDTH * GAME_HEIGHT; i++) {
-        int x = i % GAME_WIDTH;
-        int y = i / GAME_WIDTH;
-        DrawRectangle(
-            gameX + x * TileSize,
-            gameY + y * TileSize,
-            TileSize, TileSize,
-            state->map[i] ? GRAY : BLANK
-        );
+/* Draws each new state, a slow terminal only skips the states it missed */
+static void *runTerminal(void *arg) {
+    Shared *s = arg;
+    TRACE_THREAD("terminal");
+    // Lists of the last frame drawn to the terminal
+    Frame frame, drawn;
+    bool terminalDrawn = false;
+    while (true) {
+        pthread_mutex_lock(&s->terminalLock);
+        while (!s->terminalPending && !atomic_load(&s->quit)) {
+            pthread_cond_wait(&s->terminalWake, &s->terminalLock);
+        }
+        s->terminalPending = false;
+        pthread_mutex_unlock(&s->terminalLock);
+        if (atomic_load(&s->quit)) break;
+
+        TRACE_BEGIN("layout");
+        buildFrame(&frame, takeHandoff(&s->terminalState, NULL));
+        TRACE_END("layout");
+
+        // Unchanged lists leave the terminal as it is
+        if (!terminalDrawn ||
+            !displayListEquals(&frame.scene, &drawn.scene) ||
+            !displayListEquals(&frame.score, &drawn.score)) {
+            drawFrameTerminal(s->r, &frame);
+            drawn = frame;
+            terminalDrawn = true;
+        }
     }
-
-    // Active piece
-    drawPieceGUI(
-        gameX + state->x * TileSize,
-        gameY + state->y * TileSize,
-        state->pieceIndex, state->rotation
-    );
-
-    int nextPieceX = gameX + (GAME_WIDTH + 1) * TileSize;
-    // New Piece Box
-    DrawRectangleLines(
-        nextPieceX,
-        gameY,
-        (getWidthOfPiece(state->nextPieceIndex, 0) + 2) * TileSize,
-        (getHeightOfPiece(state->nextPieceIndex, 0) + 2) * TileSize,
-        GUI_BoxColor
-    );
-
-    // Next piece
-    drawPieceGUI(nextPieceX + TileSize, gameY + TileSize, state->nextPieceIndex, 0);
+    return NULL;
 }
 
-
-#define LoopDelay    50
-#define UpdateDelay  1000
-#define DrawAllDelay 1000
-#define KeyDelay     0.15
-
 int main() {
     Renderer r;
     if (initRenderer(&r) != 0) {
         return 1;
     };
     initInput();
+    // Keys arrive while the simulation sleeps, it wakes on them. Without the
+    // thread it waits on stdin itself.
+    startInputThread();
 
     SetTraceLogLevel(LOG_NONE);
     InitWindow(WIDTH, HEIGHT, "Tetris GUI");
     SetTargetFPS(60);
 
     initGame();
-    GameState state;
-    initGameState(&state);
 
-    Clock loopClock;
-    loopClock.start = clock();
-    Clock updateClock;
-    updateClock.start = clock();
+    static Shared s;
+    initGameState(&s.start);
+    atomic_init(&s.quit, false);
+    atomic_init(&s.guiHead, 0);
+    atomic_init(&s.guiTail, 0);
+    s.guiWakeFd = -1;
+    #ifndef _WIN32
+        s.guiWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (s.guiWakeFd == -1) perror("Error creating window key events");
+    #endif
+    initHandoff(&s.terminalState, &s.start);
+    initHandoff(&s.windowState, &s.start);
+    pthread_mutex_init(&s.terminalLock, NULL);
+    pthread_cond_init(&s.terminalWake, NULL);
+    s.terminalPending = true;
+    s.r = &r;
+
+    TRACE_THREAD("window");
+    pthread_t simulation, terminal;
+    bool simulationStarted = pthread_create(&simulation, NULL, runSimulation, &s) == 0;
+    bool terminalStarted = simulationStarted && pthread_create(&terminal, NULL, runTerminal, &s) == 0;
+    // Without both threads the window closes at once, through the same teardown
+    if (!terminalStarted) atomic_store(&s.quit, true);
+
     // Clock drawClock;
     // drawClock.start = clock();
 
-    Clock keyClock;
-    keyClock.start = clock();
-
-    setText(&r, 0, 0, "Score: ", Color_White);
-    char Terminal_scoreBuffer[12];
-    char GUI_scoreBuffer[20];
-    Key chr;
-    while (!WindowShouldClose()) {
-        if (!clockTick(&loopClock, LoopDelay)) continue;
-        getChar(&chr);
-        if (chr == KESC) break;
-        switch (chr) {
-            case KLEFT : moveLeft(&state); break;
-            case KRIGHT: moveRight(&state); break;
-            case KUP   : rotate(&state); break;
-            case KDOWN : moveDown(&state); break;
-            default: break;
-        }
-
-        if (clockTick(&keyClock, KeyDelay)) {
-            if (IsKeyDown(KEY_LEFT))  moveLeft(&state);
-            if (IsKeyDown(KEY_RIGHT)) moveRight(&state);
-            if (IsKeyDown(KEY_UP))    rotate(&state);
-            if (IsKeyDown(KEY_DOWN))  moveDown(&state);
-        }
-
-        if (clockTick(&updateClock, UpdateDelay)) {
-            if (updateGame(&state)) {
-                clearInputBuffer();
-            }
+    Frame frame;
+    while (!atomic_load(&s.quit) && !WindowShouldClose()) {
+        // Sampled once per frame, stamped with the sampling time
+        GUIKeyEvent events[MaxGUIKeyEvents];
+        int count = readGUIKeys(events, monotonicMs());
+        for (int i = 0; i < count; i++) {
+            pushGUIKey(&s, &events[i]);
         }
-
-        ClearBackground(BLACK);
+        if (count > 0) wakeSimulation(&s);
 
         // if (clockTick(&drawClock, DrawAllDelay)) {
         //     clear();
         //     drawAll(&r);
         // }
 
-        sprintf(Terminal_scoreBuffer, "%d", state.score);
-        setText(&r, 7, 0, Terminal_scoreBuffer, Color_Bright_White);
-
-        if (state.gameOver) {
-            setText(&r, 0, 1, "Game Over", Color_Bright_Red);
-        }
-
-        drawGameTerminal(&r, &state);
-        draw(&r);
+        TRACE_BEGIN("layout");
+        buildFrame(&frame, takeHandoff(&s.windowState, NULL));
+        TRACE_END("layout");
 
+        // EndDrawing sleeps until the next frame of SetTargetFPS, only this
+        // thread waits for it
+        TRACE_BEGIN("window");
         BeginDrawing();
-            sprintf(GUI_scoreBuffer, "Score: %d", state.score);
-            DrawText(GUI_scoreBuffer, 0, 0, 20, WHITE);
-
-            if (state.gameOver) {
-                DrawText("Game Over", 0, 20, 20, RED);
-            }
-
-            drawGameGUI(&state);
+            ClearBackground(BLACK);
+            drawFrameGUI(&frame);
         EndDrawing();
+        TRACE_END("window");
     }
+    atomic_store(&s.quit, true);
+    wakeSimulation(&s);
+    if (simulationStarted) pthread_join(simulation, NULL);
+    wakeTerminal(&s);
+    if (terminalStarted) pthread_join(terminal, NULL);
     clear();
-
+    TRACE_WRITE(TracePath);
+
+    #ifndef _WIN32
+        if (s.guiWakeFd != -1) close(s.guiWakeFd);
+    #endif
+    pthread_mutex_destroy(&s.terminalLock);
+    pthread_cond_destroy(&s.terminalWake);
+    stopInputThread();
     deinitInput();
     deinitRenderer(&r);
     CloseWindow();
+    if (!terminalStarted) {
+        fprintf(stderr, "Error starting game threads\n");
+        return 1;
+    }
     return 0;
 }
@@ -0,0 +1,172 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#ifdef USE_ZLIB
+    #include <zlib.h>
+#endif
+
+#include "game.h"
+#include "bot.h"
+#include "dataset.h"
+
+
+static void putU32(uint8_t *out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+int openDatasetWriter(DatasetWriter *w, const char *path, int chunkRows, bool compress) {
+    #ifndef USE_ZLIB
+        if (compress) {
+            fprintf(stderr, "Error: built without zlib, rebuild with ZLIB=1 for compression\n");
+            return 1;
+        }
+    #endif
+
+    memset(w, 0, sizeof(*w));
+    w->compress = compress;
+    w->chunkRows = chunkRows;
+    w->boards = malloc((size_t)chunkRows * GAME_HEIGHT * sizeof(uint16_t));
+    w->rewards = malloc((size_t)chunkRows * sizeof(float));
+    w->pieces = malloc(chunkRows);
+    w->nextPieces = malloc(chunkRows);
+    w->rotations = malloc(chunkRows);
+    w->xs = malloc(chunkRows);
+    w->out = malloc(DatasetChunkHeaderSize + (size_t)chunkRows * DatasetRowSize);
+    if (
+        w->boards == NULL || w->rewards == NULL || w->pieces == NULL ||
+        w->nextPieces == NULL || w->rotations == NULL || w->xs == NULL || w->out == NULL
+    ) {
+        fprintf(stderr, "Error: out of memory\n");
+        closeDatasetWriter(w);
+        return 1;
+    }
+
+    w->file = fopen(path, "wb");
+    if (w->file == NULL) {
+        perror("Error opening dataset");
+        closeDatasetWriter(w);
+        return 1;
+    }
+    // Chunks are written in one call each, stdio buffering would only add a copy
+    setvbuf(w->file, NULL, _IONBF, 0);
+
+    uint8_t header[DatasetHeaderSize] = { 0 };
+    memcpy(header, DatasetMagic, 4);
+    header[4] = DatasetVersion;
+    header[5] = GAME_HEIGHT;
+    header[6] = GAME_WIDTH;
+    putU32(header + 8, chunkRows);
+    if (fwrite(header, 1, DatasetHeaderSize, w->file) != DatasetHeaderSize) {
+        perror("Error writing dataset");
+        closeDatasetWriter(w);
+        return 1;
+    }
+    return 0;
+}
+
+static int flushChunk(DatasetWriter *w) {
+    if (w->rows == 0) return 0;
+    size_t rows = w->rows;
+
+    uint8_t *p = w->out + DatasetChunkHeaderSize;
+    memcpy(p, w->boards, rows * GAME_HEIGHT * sizeof(uint16_t)); p += rows * GAME_HEIGHT * sizeof(uint16_t);
+    memcpy(p, w->rewards, rows * sizeof(float));                 p += rows * sizeof(float);
+    memcpy(p, w->pieces, rows);                                  p += rows;
+    memcpy(p, w->nextPieces, rows);                              p += rows;
+    memcpy(p, w->rotations, rows);                               p += rows;
+    memcpy(p, w->xs, rows);                                      p += rows;
+
+    size_t rawSize = p - (w->out + DatasetChunkHeaderSize);
+    uint8_t *chunk = w->out;
+    size_t storedSize = rawSize;
+    uint32_t flags = 0;
+
+    #ifdef USE_ZLIB
+        if (w->compress) {
+            uLongf bound = compressBound(rawSize);
+            if (w->compressedCapacity < DatasetChunkHeaderSize + bound) {
+                free(w->compressed);
+                w->compressedCapacity = DatasetChunkHeaderSize + bound;
+                w->compressed = malloc(w->compressedCapacity);
+                if (w->compressed == NULL) {
+                    fprintf(stderr, "Error allocating dataset chunk\n");
+                    w->compressedCapacity = 0;
+                    w->error = true;
+                    return 1;
+                }
+            }
+            if (compress2(w->compressed + DatasetChunkHeaderSize, &bound, w->out + DatasetChunkHeaderSize, rawSize, Z_BEST_SPEED) != Z_OK) {
+                fprintf(stderr, "Error compressing dataset chunk\n");
+                w->error = true;
+                return 1;
+            }
+            chunk = w->compressed;
+            storedSize = bound;
+            flags |= DatasetCompressed;
+        }
+    #endif
+
+    memcpy(chunk, DatasetChunkMagic, 4);
+    putU32(chunk + 4, rows);
+    putU32(chunk + 8, storedSize);
+    putU32(chunk + 12, flags);
+
+    w->rows = 0;
+    size_t total = DatasetChunkHeaderSize + storedSize;
+    if (fwrite(chunk, 1, total, w->file) != total) {
+        perror("Error writing dataset");
+        w->error = true;
+        return 1;
+    }
+    return 0;
+}
+
+// Assumes a little endian host, like the training pipeline reading the file
+/* @return 0 on success, 1 once a chunk failed to write, later rows are
+ * dropped as the file can not be read past it */
+int appendDatasetRow(DatasetWriter *w, const GameState *state, Placement placement, float reward) {
+    if (w->error) return 1;
+    int row = w->rows;
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        w->boards[row * GAME_HEIGHT + y] = getBoardRow(state, y);
+    }
+    w->rewards[row] = reward;
+    w->pieces[row] = state->pieceIndex;
+    w->nextPieces[row] = state->nextPieceIndex;
+    w->rotations[row] = placement.rotation;
+    w->xs[row] = placement.x;
+
+    w->rows++;
+    if (w->rows == w->chunkRows) {
+        return flushChunk(w);
+    }
+    return 0;
+}
+
+/* @return 0 on success, 1 if any chunk failed to write */
+int closeDatasetWriter(DatasetWriter *w) {
+    if (w->file != NULL) {
+        if (!w->error) flushChunk(w);
+        if (fclose(w->file) != 0) {
+            perror("Error writing dataset");
+            w->error = true;
+        }
+    }
+    int error = w->error;
+
+    free(w->boards);
+    free(w->rewards);
+    free(w->pieces);
+    free(w->nextPieces);
+    free(w->rotations);
+    free(w->xs);
+    free(w->out);
+    free(w->compressed);
+    memset(w, 0, sizeof(*w));
+    return error;
+}
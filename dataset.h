@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "bot.h"
+
+
+// File layout, integers little endian:
+//   header: "TRDS" version:u8 height:u8 width:u8 0:u8 chunkRows:u32 0:u32
+//   chunks: "CHNK" rows:u32 storedSize:u32 flags:u32, then storedSize bytes
+// A chunk holds one column after another, each `rows` entries long:
+//   boards   u16[rows][GAME_HEIGHT]  bit x of a row mask is column x
+//   reward   f32[rows]               lines cleared by the placement
+//   piece    u8[rows]
+//   next     u8[rows]
+//   rotation u8[rows]
+//   x        u8[rows]
+// With DatasetCompressed set the payload is one zlib stream of those columns.
+// Uncompressed files can be read with numpy.frombuffer at fixed offsets.
+#define DatasetMagic      "TRDS"
+#define DatasetChunkMagic "CHNK"
+#define DatasetVersion    1
+#define DatasetHeaderSize 16
+#define DatasetChunkHeaderSize 16
+#define DatasetRowSize    (GAME_HEIGHT * 2 + 4 + 4)
+#define DatasetChunkRows  65536
+#define DatasetCompressed 1
+
+typedef struct {
+    FILE *file;
+    bool compress;
+    int chunkRows;
+    int rows;
+    bool error;   // a chunk was lost, the file is incomplete from there on
+    uint16_t *boards;
+    float *rewards;
+    uint8_t *pieces;
+    uint8_t *nextPieces;
+    uint8_t *rotations;
+    uint8_t *xs;
+    uint8_t *out; // serialized chunk
+    uint8_t *compressed;
+    size_t compressedCapacity;
+} DatasetWriter;
+
+
+int openDatasetWriter(DatasetWriter *w, const char *path, int chunkRows, bool compress);
+int appendDatasetRow(DatasetWriter *w, const GameState *state, Placement placement, float reward);
+int closeDatasetWriter(DatasetWriter *w);
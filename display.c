@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "display.h"
+
+
+void initDisplayList(DisplayList *list) {
+    list->count = 0;
+    list->textSize = 0;
+}
+
+/* Commands past the capacity are dropped, the scenes built here fit */
+static void addCommand(DisplayList *list, DrawCommandType type, DrawStyle style, int x, int y, int a, int b) {
+    if (list->count == DisplayListCapacity) return;
+    list->commands[list->count++] = (DrawCommand){
+        .type = type,
+        .style = style,
+        .x = x,
+        .y = y,
+        .a = a,
+        .b = b
+    };
+}
+
+void addCell(DisplayList *list, int x, int y, DrawStyle style) {
+    addCommand(list, Draw_Cell, style, x, y, 0, 0);
+}
+
+void addRow(DisplayList *list, int x, int y, int width, uint16_t mask) {
+    addCommand(list, Draw_Row, Style_Locked, x, y, mask, width);
+}
+
+void addBox(DisplayList *list, int x, int y, int width, int height) {
+    addCommand(list, Draw_Box, Style_Box, x, y, width, height);
+}
+
+void addClear(DisplayList *list, int x, int y, int width, int height) {
+    addCommand(list, Draw_Clear, Style_Empty, x, y, width, height);
+}
+
+void addText(DisplayList *list, int x, int y, const char *text, DrawStyle style) {
+    int length = strlen(text);
+    if (list->textSize + length > DisplayListTextSize) return;
+    memcpy(list->text + list->textSize, text, length);
+    addCommand(list, Draw_Text, style, x, y, list->textSize, length);
+    list->textSize += length;
+}
+
+bool displayListEquals(const DisplayList *a, const DisplayList *b) {
+    return
+        a->count == b->count && a->textSize == b->textSize &&
+        memcmp(a->commands, b->commands, a->count * sizeof(DrawCommand)) == 0 &&
+        memcmp(a->text, b->text, a->textSize) == 0;
+}
+
+static void addPiece(DisplayList *list, int x, int y, int pieceIndex, int rotation) {
+    int xs[PieceTiles], ys[PieceTiles];
+    int count = getPieceCells(pieceIndex, rotation, xs, ys);
+    for (int i = 0; i < count; i++) {
+        addCell(list, x + xs[i], y + ys[i], pieceIndex);
+    }
+}
+
+// Board with its box and the active piece, see the Scene constants for the layout
+void buildBoardScene(DisplayList *list, const GameState *state) {
+    // Game Map
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        addRow(list, SceneBoardX, SceneBoardY + y, GAME_WIDTH, getBoardRow(state, y));
+    }
+
+    // Active piece
+    addPiece(list, SceneBoardX + state->x, SceneBoardY + state->y, state->pieceIndex, state->rotation);
+
+    // Game Box
+    addBox(list, SceneBoardX, SceneBoardY, GAME_WIDTH, GAME_HEIGHT);
+}
+
+// The board scene and the next piece box right of it
+void buildGameScene(DisplayList *list, const GameState *state) {
+    buildBoardScene(list, state);
+
+    // Clear next piece area, boxes of bigger pieces leave their outline behind
+    addClear(list, SceneNextX - 1, SceneNextY - 1, 8, 6);
+
+    // New Piece Box
+    addBox(list,
+        SceneNextX,
+        SceneNextY,
+        getWidthOfPiece(state->nextPieceIndex, 0) + 2,
+        getHeightOfPiece(state->nextPieceIndex, 0) + 2
+    );
+
+    // Next piece
+    addPiece(list, SceneNextX + 1, SceneNextY + 1, state->nextPieceIndex, 0);
+}
+
+// Score line and the game over notice, from the top left corner
+void buildScoreScene(DisplayList *list, const GameState *state) {
+    char scoreBuffer[12];
+    sprintf(scoreBuffer, "%d", state->score);
+    addText(list, 0, 0, "Score: ", Style_Text);
+    addText(list, 7, 0, scoreBuffer, Style_Score);
+
+    if (state->gameOver) {
+        addText(list, 0, 1, "Game Over", Style_GameOver);
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "game.h"
+
+
+// A frame described once in tile units, for any backend to draw. Coordinates
+// are relative to wherever the backend places the list. Per command type:
+//   Draw_Cell   one tile at x, y
+//   Draw_Row    width tiles from x, y; bit i of mask set draws Style_Locked,
+//               clear draws Style_Empty
+//   Draw_Box    outline around the a x b tiles starting at x, y
+//   Draw_Clear  a x b empty tiles starting at x, y
+//   Draw_Text   b bytes of utf-8 from offset a of the text pool
+typedef enum {
+    Draw_Cell,
+    Draw_Row,
+    Draw_Box,
+    Draw_Clear,
+    Draw_Text
+} DrawCommandType;
+
+// Styles below NumberOfPieces are the piece of that index
+typedef enum {
+    Style_Locked = NumberOfPieces,
+    Style_Empty,
+    Style_Box,
+    Style_Text,
+    Style_Score,
+    Style_GameOver,
+    Style_Count
+} DrawStyle;
+
+typedef struct {
+    uint8_t type;
+    uint8_t style;
+    int16_t x;
+    int16_t y;
+    uint16_t a;
+    uint16_t b;
+} DrawCommand;
+
+#define DisplayListCapacity 64
+#define DisplayListTextSize 256
+
+typedef struct {
+    int count;
+    int textSize;
+    DrawCommand commands[DisplayListCapacity];
+    char text[DisplayListTextSize];
+} DisplayList;
+
+// Scene layout, the board box is at 0, 0 with the board inside it
+#define SceneBoardX     1
+#define SceneBoardY     1
+#define SceneNextX      (GAME_WIDTH + 4)
+#define SceneNextY      1
+#define SceneWidth      (GAME_WIDTH + 12)
+#define SceneHeight     (GAME_HEIGHT + 2)
+
+
+void initDisplayList(DisplayList *list);
+void addCell(DisplayList *list, int x, int y, DrawStyle style);
+void addRow(DisplayList *list, int x, int y, int width, uint16_t mask);
+void addBox(DisplayList *list, int x, int y, int width, int height);
+void addClear(DisplayList *list, int x, int y, int width, int height);
+void addText(DisplayList *list, int x, int y, const char *text, DrawStyle style);
+bool displayListEquals(const DisplayList *a, const DisplayList *b);
+
+void buildBoardScene(DisplayList *list, const GameState *state);
+void buildGameScene(DisplayList *list, const GameState *state);
+void buildScoreScene(DisplayList *list, const GameState *state);
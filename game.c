@@ -135,9 +135,19 @@ static bool collidesWithMap(const GameState *state) {
     return false;
 }
 
+// xorshift32, kept per state so games are reproducible from their seed
+static int randomPiece(GameState *state) {
+    uint32_t x = state->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state->rng = x;
+    return x % NumberOfPieces;
+}
+
 static void newPiece(GameState *state) {
     state->pieceIndex = state->nextPieceIndex;
-    state->nextPieceIndex = rand() % NumberOfPieces;
+    state->nextPieceIndex = randomPiece(state);
     state->rotation = 0;
     state->pieceWidth = getWidthOfPiece(state->pieceIndex, state->rotation);
     state->pieceHeight = getHeightOfPiece(state->pieceIndex, state->rotation);
@@ -181,11 +191,17 @@ void initGame() {
 }
 
 void initGameState(GameState *state) {
+    initGameStateSeeded(state, rand());
+}
+
+void initGameStateSeeded(GameState *state, uint32_t seed) {
     for (int i = 0; i < GAME_WIDTH * GAME_HEIGHT; i++) {
         state->map[i] = false;
     }
 
-    state->nextPieceIndex = rand() % NumberOfPieces;
+    // xorshift never leaves zero
+    state->rng = seed != 0 ? seed : 0x9E3779B9;
+    state->nextPieceIndex = randomPiece(state);
     newPiece(state);
     state->score = 0;
     state->gameOver = false;
@@ -241,17 +257,37 @@ uint8_t getSpecificPiece(int pieceIndex, int rotation) {
     return rotations[pieceIndex * 3 + (rotation - 1)];
 }
 
-void getPieceDrawInfo(int pieceIndex, int rotation, void (*callback)(void *ctx, int pieceIndex, int x, int y), void *ctx) {
+// Bit x of the row is set when the tile at column x is filled
+uint16_t getBoardRow(const GameState *state, int y) {
+    uint16_t row = 0;
+    for (int x = 0; x < GAME_WIDTH; x++) {
+        if (state->map[getGameIndex(x, y)]) {
+            row |= 1 << x;
+        }
+    }
+    return row;
+}
+
+void setBoardRow(GameState *state, int y, uint16_t row) {
+    for (int x = 0; x < GAME_WIDTH; x++) {
+        state->map[getGameIndex(x, y)] = (row >> x) & 1;
+    }
+}
+
+/* Fills x and y with the tiles of a piece relative to its top left
+ * @return the number of tiles */
+int getPieceCells(int pieceIndex, int rotation, int *x, int *y) {
     uint8_t piece = getSpecificPiece(pieceIndex, rotation);
     bool columnLayout = isColumnLayout(rotation);
 
+    int count = 0;
     for (int i = 0; i < 8; i++) {
         bool bit = (piece << i) & 0b10000000;
         if (!bit) continue;
-        int x, y;
-        byteIndexToRelativePosition(i, columnLayout, &x, &y);
-        callback(ctx, pieceIndex, x, y);
+        byteIndexToRelativePosition(i, columnLayout, &x[count], &y[count]);
+        count++;
     }
+    return count;
 }
 
 void moveLeft(GameState *state) {
@@ -5,6 +5,7 @@
 
 
 #define NumberOfPieces 7
+#define PieceTiles     4
 #define GAME_WIDTH  10
 #define GAME_HEIGHT 16
 
@@ -20,6 +21,7 @@ typedef struct {
     int score;
     bool gameOver;
     int nextPieceIndex;
+    uint32_t rng; // piece generator state, advanced by every new piece
 } GameState;
 
 extern const uint8_t pieces[NumberOfPieces];
@@ -27,13 +29,16 @@ extern uint8_t rotations[NumberOfPieces * 3];
 
 void initGame();
 void initGameState(GameState *state);
+void initGameStateSeeded(GameState *state, uint32_t seed);
 
 bool isColumnLayout(int rotation);
 int getWidthOfPiece(int pieceIndex, int rotation);
 int getHeightOfPiece(int pieceIndex, int rotation);
 uint8_t getPiece(const GameState *state);
 uint8_t getSpecificPiece(int pieceIndex, int rotation);
-void getPieceDrawInfo(int pieceIndex, int rotation, void (*callback)(void *ctx, int pieceIndex, int x, int y), void *ctx);
+uint16_t getBoardRow(const GameState *state, int y);
+void setBoardRow(GameState *state, int y, uint16_t row);
+int getPieceCells(int pieceIndex, int rotation, int *x, int *y);
 
 void moveLeft(GameState *state);
 void moveRight(GameState *state);
@@ -0,0 +1,52 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "replay.h"
+#include "repeat.h"
+#include "gui-input.h"
+#include "raylib.h"
+
+
+static const int GUIKey[GUIKeys] = { KEY_LEFT, KEY_RIGHT, KEY_UP, KEY_DOWN };
+static const ReplayEventType GUIMove[GUIKeys] = { Replay_Left, Replay_Right, Replay_Rotate, Replay_Down };
+
+/* Arrow key changes since the last frame, releases first so a key released
+ * and pressed again within one frame ends up held. Only reads raylib state,
+ * the events can be played on another thread.
+ * @return the number of events, at most MaxGUIKeyEvents */
+int readGUIKeys(GUIKeyEvent *events, uint64_t now) {
+    int count = 0;
+    for (int i = 0; i < GUIKeys; i++) {
+        if (IsKeyReleased(GUIKey[i])) events[count++] = (GUIKeyEvent){ GUIMove[i], true, now };
+    }
+    for (int i = 0; i < GUIKeys; i++) {
+        if (IsKeyPressed(GUIKey[i])) events[count++] = (GUIKeyEvent){ GUIMove[i], false, now };
+    }
+    return count;
+}
+
+void playGUIKey(KeyRepeat *repeat, GameState *state, const GUIKeyEvent *event) {
+    if (event->released) {
+        releaseRepeatKey(repeat, event->move, event->time);
+        return;
+    }
+    applyReplayEvent(state, event->move);
+    pressRepeatKey(repeat, event->move, event->time);
+}
+
+/* Plays the arrow keys since the last frame. raylib samples keys once per
+ * frame, so presses and releases take the frame time while the repeats of
+ * held keys in between fall at their exact times, whatever the frame rate. */
+void playGUIKeys(KeyRepeat *repeat, GameState *state, uint64_t now) {
+    ReplayEventType move;
+    while ((move = nextRepeatMove(repeat, state, now)) != Replay_End) {
+        applyReplayEvent(state, move);
+    }
+
+    GUIKeyEvent events[MaxGUIKeyEvents];
+    int count = readGUIKeys(events, now);
+    for (int i = 0; i < count; i++) {
+        playGUIKey(repeat, state, &events[i]);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "repeat.h"
+
+
+#define GUIKeys 4
+// Most events a frame can sample, every key released and pressed again
+#define MaxGUIKeyEvents (GUIKeys * 2)
+
+typedef struct {
+    uint8_t move; // ReplayEventType
+    bool released;
+    uint64_t time;
+} GUIKeyEvent;
+
+
+int readGUIKeys(GUIKeyEvent *events, uint64_t now);
+void playGUIKey(KeyRepeat *repeat, GameState *state, const GUIKeyEvent *event);
+void playGUIKeys(KeyRepeat *repeat, GameState *state, uint64_t now);
@@ -0,0 +1,65 @@
+#include <string.h>
+
+#include "display.h"
+#include "gui-view.h"
+#include "raylib.h"
+
+
+// Indexed by DrawStyle
+static const Color StyleColor[] = {
+    RED,
+    GREEN,
+    YELLOW,
+    BLUE,
+    MAGENTA,
+    SKYBLUE,
+    RAYWHITE,
+    [Style_Locked]   = GRAY,
+    [Style_Empty]    = BLANK,
+    [Style_Box]      = WHITE,
+    [Style_Text]     = WHITE,
+    [Style_Score]    = WHITE,
+    [Style_GameOver] = RED
+};
+
+// originX, originY: pixel position of tile 0, 0 of the list
+void drawDisplayListGUI(const DisplayList *list, int originX, int originY) {
+    // Font glyphs are narrower than tiles, text continuing the previous text
+    // on its line is drawn right after it instead of at its tile
+    int textEndTile = -1, textEndY = -1, textEndPixel = 0;
+
+    for (int i = 0; i < list->count; i++) {
+        const DrawCommand *c = &list->commands[i];
+        Color color = StyleColor[c->style];
+        int x = originX + c->x * TileSize;
+        int y = originY + c->y * TileSize;
+        switch (c->type) {
+            case Draw_Cell:
+                DrawRectangle(x, y, TileSize, TileSize, color);
+                break;
+            case Draw_Row:
+                for (int bit = 0; bit < c->b; bit++) {
+                    if ((c->a >> bit) & 1) DrawRectangle(x + bit * TileSize, y, TileSize, TileSize, color);
+                }
+                break;
+            case Draw_Box:
+                DrawRectangleLines(x - 2, y - 2, c->a * TileSize + 4, c->b * TileSize + 4, color);
+                break;
+            case Draw_Clear:
+                // The whole window is cleared every frame
+                break;
+            case Draw_Text: {
+                char text[DisplayListTextSize + 1];
+                memcpy(text, list->text + c->a, c->b);
+                text[c->b] = '\0';
+                if (c->x == textEndTile && c->y == textEndY) x = textEndPixel;
+
+                DrawText(text, x, y, TileSize, color);
+                textEndTile = c->x + c->b;
+                textEndY = c->y;
+                textEndPixel = x + MeasureText(text, TileSize);
+                break;
+            }
+        }
+    }
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "display.h"
+#include "raylib.h"
+
+
+#define TileSize 20
+
+void drawDisplayListGUI(const DisplayList *list, int originX, int originY);
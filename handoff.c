@@ -0,0 +1,36 @@
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "game.h"
+#include "handoff.h"
+
+
+void initHandoff(StateHandoff *h, const GameState *state) {
+    for (int i = 0; i < 3; i++) {
+        h->buffers[i] = *state;
+    }
+    h->back = 0;
+    atomic_init(&h->middle, 1);
+    h->front = 2;
+}
+
+/* Writer side, copies the state and makes it the newest */
+void publishHandoff(StateHandoff *h, const GameState *state) {
+    h->buffers[h->back] = *state;
+    unsigned previous = atomic_exchange_explicit(&h->middle, h->back | HandoffFresh, memory_order_acq_rel);
+    h->back = previous & ~HandoffFresh;
+}
+
+/* Reader side, the state stays valid until the next call
+ * @return the newest state published, fresh tells if it changed since the
+ * last call */
+const GameState *takeHandoff(StateHandoff *h, bool *fresh) {
+    bool newer = atomic_load_explicit(&h->middle, memory_order_relaxed) & HandoffFresh;
+    if (newer) {
+        unsigned previous = atomic_exchange_explicit(&h->middle, h->front, memory_order_acq_rel);
+        h->front = previous & ~HandoffFresh;
+    }
+    if (fresh != NULL) *fresh = newer;
+    return &h->buffers[h->front];
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "game.h"
+
+
+// Latest GameState from one thread to another through three buffers. The
+// writer fills its back buffer and swaps it with the middle one, the reader
+// swaps the middle one with its front buffer when it holds a newer state.
+// Neither side ever waits, the reader always has a whole state and states it
+// was too slow for are skipped.
+#define HandoffFresh 4 // set in middle while the reader has not taken it
+
+typedef struct {
+    GameState buffers[3];
+    atomic_uint middle; // buffer index | HandoffFresh
+    unsigned back;      // writer only
+    unsigned front;     // reader only
+} StateHandoff;
+
+
+void initHandoff(StateHandoff *h, const GameState *state);
+void publishHandoff(StateHandoff *h, const GameState *state);
+const GameState *takeHandoff(StateHandoff *h, bool *fresh);
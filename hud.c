@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "latency.h"
+#include "terminal/renderer.h"
+#include "hud.h"
+
+
+static void resetWindow(PerfHud *hud, uint64_t now) {
+    initLatency(&hud->frameTimes);
+    hud->frames = 0;
+    hud->cells = 0;
+    hud->bytes = 0;
+    hud->syscalls = 0;
+    hud->ticks = 0;
+    hud->maxQueue = 0;
+    hud->windowStart = now;
+}
+
+void initHud(PerfHud *hud, bool visible, uint64_t now) {
+    hud->visible = visible;
+    memset(hud->lines, 0, sizeof(hud->lines));
+    resetWindow(hud, now);
+}
+
+/* bytes and syscalls are those of this frame alone */
+void recordHudFrame(PerfHud *hud, uint64_t frameUs, int cells, size_t bytes, size_t syscalls) {
+    recordLatency(&hud->frameTimes, frameUs);
+    hud->frames++;
+    hud->cells += cells;
+    hud->bytes += bytes;
+    hud->syscalls += syscalls;
+}
+
+void recordHudTick(PerfHud *hud) {
+    hud->ticks++;
+}
+
+void recordHudQueue(PerfHud *hud, int depth) {
+    if (depth > hud->maxQueue) hud->maxQueue = depth;
+}
+
+/* Lines are padded to HudWidth, drawing them covers the previous ones */
+static void drawLines(PerfHud *hud, Renderer *r, bool blank) {
+    char line[HudWidth + 1];
+    for (int i = 0; i < HudLines; i++) {
+        snprintf(line, sizeof(line), "%-*s", HudWidth, blank ? "" : hud->lines[i]);
+        setText(r, HudX, HudY + i, line, Color_Bright_Black);
+    }
+}
+
+void toggleHud(PerfHud *hud, Renderer *r) {
+    hud->visible = !hud->visible;
+    drawLines(hud, r, !hud->visible);
+}
+
+/* Closes the window once HudWindowMs passed and draws its numbers */
+void updateHud(PerfHud *hud, Renderer *r, uint64_t now) {
+    uint64_t elapsed = now - hud->windowStart;
+    if (elapsed < HudWindowMs) return;
+
+    double frames = hud->frames ? hud->frames : 1;
+    uint64_t average = hud->frameTimes.count ? hud->frameTimes.total / hud->frameTimes.count : 0;
+    snprintf(hud->lines[0], HudWidth + 1, "frames   %.0f/s", hud->frames * 1000.0 / elapsed);
+    snprintf(hud->lines[1], HudWidth + 1, "frame    %lluus p99 %llu",
+        (unsigned long long)average, (unsigned long long)getLatencyPercentile(&hud->frameTimes, 99));
+    snprintf(hud->lines[2], HudWidth + 1, "cells    %.1f/frame", hud->cells / frames);
+    snprintf(hud->lines[3], HudWidth + 1, "bytes    %.1f/frame", hud->bytes / frames);
+    snprintf(hud->lines[4], HudWidth + 1, "syscalls %.1f/frame", hud->syscalls / frames);
+    snprintf(hud->lines[5], HudWidth + 1, "ticks    %.1f/s", hud->ticks * 1000.0 / elapsed);
+    snprintf(hud->lines[6], HudWidth + 1, "queue    %d max", hud->maxQueue);
+    resetWindow(hud, now);
+
+    if (hud->visible) drawLines(hud, r, false);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "latency.h"
+#include "terminal/renderer.h"
+
+
+// Live rendering pressure, drawn below the score. Counters only add up
+// during a window of HudWindowMs, the lines are formatted and drawn once
+// per window, so the HUD changes a few cells a second at most.
+#define HudWindowMs 1000
+#define HudX        0
+#define HudY        3
+#define HudLines    7
+#define HudWidth    24
+
+typedef struct {
+    bool visible;
+    uint64_t windowStart; // monotonicMs()
+
+    // Current window
+    LatencyHistogram frameTimes; // wakeup to flushed frame, us
+    uint64_t frames;
+    uint64_t cells;
+    uint64_t bytes;
+    uint64_t syscalls;
+    uint64_t ticks;
+    int maxQueue;
+
+    // Last window, as drawn
+    char lines[HudLines][HudWidth + 1];
+} PerfHud;
+
+
+void initHud(PerfHud *hud, bool visible, uint64_t now);
+void recordHudFrame(PerfHud *hud, uint64_t frameUs, int cells, size_t bytes, size_t syscalls);
+void recordHudTick(PerfHud *hud);
+void recordHudQueue(PerfHud *hud, int depth);
+void toggleHud(PerfHud *hud, Renderer *r);
+void updateHud(PerfHud *hud, Renderer *r, uint64_t now);
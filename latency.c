@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "latency.h"
+
+
+void initLatency(LatencyHistogram *h) {
+    memset(h, 0, sizeof(LatencyHistogram));
+}
+
+static int getLatencyBucket(uint64_t us) {
+    if (us < LatencySubBuckets) return us;
+
+    // Keep the top LatencySubBits bits, the highest of them is always set
+    int highBit = 63 - __builtin_clzll(us);
+    int shift = highBit - (LatencySubBits - 1);
+    if (shift > LatencyRanges) return LatencyBuckets - 1;
+    int sub = (us >> shift) - LatencySubBuckets / 2;
+    return LatencySubBuckets + (shift - 1) * (LatencySubBuckets / 2) + sub;
+}
+
+/* @return the highest value counted in a bucket */
+static uint64_t getBucketLimit(int bucket) {
+    if (bucket < LatencySubBuckets) return bucket;
+
+    int shift = (bucket - LatencySubBuckets) / (LatencySubBuckets / 2) + 1;
+    int sub = (bucket - LatencySubBuckets) % (LatencySubBuckets / 2);
+    return ((uint64_t)(LatencySubBuckets / 2 + sub + 1) << shift) - 1;
+}
+
+void recordLatency(LatencyHistogram *h, uint64_t us) {
+    h->buckets[getLatencyBucket(us)]++;
+    h->count++;
+    h->total += us;
+    if (us > h->max) h->max = us;
+}
+
+/* @return the latency in us that the given percent (0 - 100) of samples
+ * do not exceed, 0 without samples */
+uint64_t getLatencyPercentile(const LatencyHistogram *h, double percentile) {
+    if (h->count == 0) return 0;
+    uint64_t rank = (uint64_t)(percentile / 100 * h->count + 0.5);
+    if (rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LatencyBuckets; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint64_t limit = getBucketLimit(i);
+            return limit < h->max ? limit : h->max;
+        }
+    }
+    return h->max;
+}
+
+/* Replaces the file with a summary, one "name value" pair per line, times in us
+ * @return 0 on success */
+int writeLatencyReport(const LatencyHistogram *h, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror("Error opening latency report");
+        return 1;
+    }
+
+    static const double Percentiles[] = { 50, 90, 99, 99.9, 99.99 };
+    fprintf(file, "samples %llu\n", (unsigned long long)h->count);
+    fprintf(file, "mean %llu\n", (unsigned long long)(h->count ? h->total / h->count : 0));
+    for (size_t i = 0; i < sizeof(Percentiles) / sizeof(Percentiles[0]); i++) {
+        fprintf(file, "p%g %llu\n", Percentiles[i], (unsigned long long)getLatencyPercentile(h, Percentiles[i]));
+    }
+    fprintf(file, "max %llu\n", (unsigned long long)h->max);
+
+    if (fclose(file) != 0) {
+        perror("Error writing latency report");
+        return 1;
+    }
+    return 0;
+}
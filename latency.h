@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+
+// Log-linear buckets in microseconds, as in HDR histograms: values below
+// LatencySubBuckets have a bucket each, every power of two above that is
+// split into LatencySubBuckets / 2 buckets. Percentiles are within 1/16 of
+// the true value, values past the last range count in the last bucket.
+#define LatencySubBits    5
+#define LatencySubBuckets (1 << LatencySubBits)
+#define LatencyRanges     24 // up to 2^(LatencyRanges + LatencySubBits) us, about 9 minutes
+#define LatencyBuckets    (LatencySubBuckets + LatencyRanges * LatencySubBuckets / 2)
+
+typedef struct {
+    uint64_t count;
+    uint64_t total; // us
+    uint64_t max;   // us
+    uint64_t buckets[LatencyBuckets];
+} LatencyHistogram;
+
+
+void initLatency(LatencyHistogram *h);
+void recordLatency(LatencyHistogram *h, uint64_t us);
+uint64_t getLatencyPercentile(const LatencyHistogram *h, double percentile);
+int writeLatencyReport(const LatencyHistogram *h, const char *path);
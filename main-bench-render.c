@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "game.h"
+#include "view.h"
+#include "terminal/renderer.h"
+#include "terminal/trace.h"
+
+
+// Inputs per gravity tick, roughly a fast human player
+#define MovesPerTick 4
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t nextRandom(uint32_t *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+/* Advances the game by one frame: a random move, or gravity every few frames */
+static void stepGame(GameState *state, uint32_t *rng, long frame) {
+    if (frame % MovesPerTick == MovesPerTick - 1) {
+        updateGame(state);
+    } else {
+        switch (nextRandom(rng) % 4) {
+            case 0: moveLeft(state); break;
+            case 1: moveRight(state); break;
+            case 2: rotate(state); break;
+            case 3: moveDown(state); break;
+        }
+    }
+    if (state->gameOver) initGameStateSeeded(state, nextRandom(rng));
+}
+
+int main(int argc, char **argv) {
+    long frames = 100000;
+    int width = 80;
+    int height = 24;
+    bool null = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            frames = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-W") == 0 && i + 1 < argc) {
+            width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-H") == 0 && i + 1 < argc) {
+            height = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--null") == 0) {
+            null = true;
+        } else {
+            fprintf(stderr, "Usage: %s [-n <frames>] [-W <width>] [-H <height>] [--null]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (width < GAME_WIDTH + ViewSideWidth + 2 || height < GAME_HEIGHT + 2 || frames < 1) {
+        fprintf(stderr, "Error: the board needs at least %dx%d cells\n", GAME_WIDTH + ViewSideWidth + 2, GAME_HEIGHT + 2);
+        return 2;
+    }
+
+    Renderer r;
+    if (initRendererSized(&r, width, height, null ? nullSink() : memorySink()) != 0) return 1;
+    size_t initialBytes = r.sink.written;
+
+    initGame();
+    GameState state;
+    uint32_t rng = 1;
+    initGameStateSeeded(&state, rng);
+
+    setText(&r, 0, 0, "Score: ", Color_White);
+    char scoreBuffer[12];
+
+    long cells = 0;
+    double start = nowSeconds();
+    for (long frame = 0; frame < frames; frame++) {
+        TRACE_BEGIN("update");
+        stepGame(&state, &rng, frame);
+        TRACE_END("update");
+
+        TRACE_BEGIN("layout");
+        sprintf(scoreBuffer, "%d", state.score);
+        setText(&r, 7, 0, scoreBuffer, Color_Bright_White);
+        drawGame(&r, &state);
+        TRACE_END("layout");
+        draw(&r);
+
+        cells += r.changedCount;
+        // Only the byte count matters, keep the buffer from growing
+        r.sink.size = 0;
+    }
+    double elapsed = nowSeconds() - start;
+    size_t bytes = r.sink.written - initialBytes;
+
+    printf("Frames: %ld at %dx%d, %.0f frames/s (%.2f us/frame)\n",
+        frames, width, height, frames / elapsed, elapsed * 1e6 / frames);
+    printf("Output: %.1f bytes/frame, %.1f cells/frame\n", (double)bytes / frames, (double)cells / frames);
+
+    TRACE_WRITE(TracePath);
+    deinitRenderer(&r);
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "game.h"
+#include "bot.h"
+#include "dataset.h"
+#include "stats.h"
+
+
+#define MaxThreads 256
+
+typedef struct {
+    int games;
+    uint32_t seed;
+    long maxPieces;
+    DatasetWriter *dataset; // only written with a single thread
+    bool collectStats;
+    atomic_int next;
+} HeadlessJob;
+
+// Each worker aggregates into its own counters, merged after the join
+typedef struct {
+    HeadlessJob *job;
+    long pieces;
+    long score;
+    PlayStats stats;
+} HeadlessWorker;
+
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-n <games>] [-s <seed>] [-j <threads>] [--max-pieces <n>]\n", name);
+    fprintf(stderr, "       [--export <dataset> [--compress]] [--stats <file.csv|file>]\n");
+}
+
+static void *runWorker(void *arg) {
+    HeadlessWorker *worker = arg;
+    HeadlessJob *job = worker->job;
+
+    int game;
+    while ((game = atomic_fetch_add(&job->next, 1)) < job->games) {
+        GameState state;
+        initGameStateSeeded(&state, job->seed + game);
+
+        long pieces = 0;
+        for (; !state.gameOver && pieces < job->maxPieces; pieces++) {
+            Placement placement = choosePlacement(&state);
+            GameState before = state;
+            int lines = playPlacement(&state, placement);
+            // The export stops at the first lost chunk, closeDatasetWriter
+            // still reports it
+            if (job->dataset != NULL && appendDatasetRow(job->dataset, &before, placement, lines) != 0) {
+                job->dataset = NULL;
+            }
+            if (job->collectStats) {
+                addPlacementStats(&worker->stats, &before, placement, lines, &state);
+            }
+        }
+        if (job->collectStats) {
+            addGameStats(&worker->stats, pieces, &state);
+        }
+        worker->pieces += pieces;
+        worker->score += state.score;
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int games = 1;
+    int threads = 1;
+    uint32_t seed = time(NULL);
+    long maxPieces = 100000;
+    const char *exportPath = NULL;
+    const char *statsPath = NULL;
+    bool compress = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            games = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-pieces") == 0 && i + 1 < argc) {
+            maxPieces = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            exportPath = argv[++i];
+        } else if (strcmp(argv[i], "--compress") == 0) {
+            compress = true;
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            statsPath = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (threads < 1 || threads > MaxThreads) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (exportPath != NULL && threads != 1) {
+        fprintf(stderr, "Error: --export writes rows in game order and needs -j 1\n");
+        return 1;
+    }
+
+    initGame();
+
+    DatasetWriter dataset;
+    if (exportPath != NULL && openDatasetWriter(&dataset, exportPath, DatasetChunkRows, compress) != 0) {
+        return 1;
+    }
+
+    HeadlessJob job = {
+        .games = games,
+        .seed = seed,
+        .maxPieces = maxPieces,
+        .dataset = exportPath != NULL ? &dataset : NULL,
+        .collectStats = statsPath != NULL
+    };
+    atomic_init(&job.next, 0);
+
+    // Separate allocations keep the workers' counters on their own cache lines
+    HeadlessWorker *workers[MaxThreads];
+    pthread_t ids[MaxThreads];
+    for (int i = 0; i < threads; i++) {
+        workers[i] = calloc(1, sizeof(HeadlessWorker));
+        if (workers[i] == NULL) {
+            perror("Error allocating worker");
+            return 1;
+        }
+        workers[i]->job = &job;
+    }
+
+    double start = nowSeconds();
+    int started = 0;
+    while (started < threads && pthread_create(&ids[started], NULL, runWorker, workers[started]) == 0) {
+        started++;
+    }
+    if (started < threads) {
+        // No more games are handed out, the results would be missing some
+        atomic_store(&job.next, games);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    double elapsed = nowSeconds() - start;
+    if (started < threads) {
+        fprintf(stderr, "Error starting worker threads\n");
+        for (int i = 0; i < threads; i++) {
+            free(workers[i]);
+        }
+        if (exportPath != NULL) closeDatasetWriter(&dataset);
+        return 1;
+    }
+
+    long totalPieces = 0;
+    long totalScore = 0;
+    PlayStats stats;
+    initStats(&stats);
+    for (int i = 0; i < threads; i++) {
+        totalPieces += workers[i]->pieces;
+        totalScore += workers[i]->score;
+        mergeStats(&stats, &workers[i]->stats);
+        free(workers[i]);
+    }
+
+    int error = 0;
+    if (exportPath != NULL) {
+        error = closeDatasetWriter(&dataset);
+    }
+    if (statsPath != NULL) {
+        error |= writeStats(&stats, statsPath);
+    }
+
+    printf("Games:  %d (seed %u, %d threads)\n", games, seed, threads);
+    printf("Pieces: %ld, %.0f pieces/s\n", totalPieces, totalPieces / (elapsed > 0 ? elapsed : 1e-9));
+    printf("Score:  %.1f average\n", (double)totalScore / (games > 0 ? games : 1));
+    return error;
+}
@@ -0,0 +1,55 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "game.h"
+#include "publish.h"
+
+
+#define PollDelayMs 10
+
+int main(int argc, char **argv) {
+    bool board = argc == 3 && strcmp(argv[2], "--board") == 0;
+    if (argc != 2 && !board) {
+        fprintf(stderr, "Usage: %s <name> [--board]\n", argv[0]);
+        return 2;
+    }
+
+    Observer o;
+    if (openObserver(&o, argv[1]) != 0) return 1;
+    initGame();
+
+    uint64_t seen = 0;
+    GameState state;
+    struct timespec delay = { 0, PollDelayMs * 1000000L };
+    while (true) {
+        uint64_t head;
+        if (!readLatestState(&o, &state, &head) || head == seen) {
+            nanosleep(&delay, NULL);
+            continue;
+        }
+
+        printf("#%llu score %d piece %d (%d, %d) rotation %d next %d%s\n",
+            (unsigned long long)head, state.score, state.pieceIndex,
+            state.x, state.y, state.rotation, state.nextPieceIndex,
+            head - seen > 1 && seen != 0 ? " (skipped some)" : "");
+        seen = head;
+
+        if (board) {
+            for (int y = 0; y < GAME_HEIGHT; y++) {
+                uint16_t row = getBoardRow(&state, y);
+                for (int x = 0; x < GAME_WIDTH; x++) {
+                    putchar((row >> x) & 1 ? '#' : '.');
+                }
+                putchar('\n');
+            }
+        }
+        fflush(stdout);
+
+        if (state.gameOver) break;
+    }
+
+    closeObserver(&o);
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <time.h>
+#endif
+
+#include "replay.h"
+#include "terminal/renderer.h"
+#include "terminal/input.h"
+
+
+static void sleepSeconds(double seconds) {
+    if (seconds <= 0) return;
+    #ifdef _WIN32
+        Sleep((DWORD)(seconds * 1000));
+    #else
+        struct timespec ts;
+        ts.tv_sec = (time_t)seconds;
+        ts.tv_nsec = (long)((seconds - ts.tv_sec) * 1e9);
+        nanosleep(&ts, NULL);
+    #endif
+}
+
+/* @return 1 if a frame was applied, 0 at the end of the capture, -1 on malformed data */
+static int playFrame(Renderer *r, const uint8_t *data, size_t size, size_t *pos, int width, uint32_t *deltaMs) {
+    if (*pos == size) return 0;
+
+    uint32_t count;
+    if (readVarint(data, size, pos, deltaMs) || readVarint(data, size, pos, &count)) return -1;
+
+    int index = -1;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t gap;
+        if (readVarint(data, size, pos, &gap) || *pos >= size) return -1;
+        index += (gap & 1 ? -(int)(gap >> 1) - 1 : (int)(gap >> 1)) + 1;
+
+        uint8_t info = data[(*pos)++];
+        int length = info & 7;
+        if (length > UTF8CharacterLength || *pos + length > size) return -1;
+
+        CharacterNT chr = { 0 };
+        memcpy(chr, data + *pos, length);
+        *pos += length;
+
+        // Cells outside a smaller terminal are dropped
+        int x = index % width;
+        int y = index / width;
+        if (index >= 0 && x < r->width && y < r->height) {
+            setChar(r, x, y, chr, info >> 3);
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    double speed = 1;
+    const char *path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-x") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+        } else if (path == NULL) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "Usage: %s <capture> [-x <speed>, 0 for no delay]\n", argv[0]);
+        return 2;
+    }
+
+    size_t size;
+    uint8_t *data = readWholeFile(path, &size);
+    if (data == NULL) {
+        perror("Error reading capture");
+        return 2;
+    }
+
+    size_t pos = 5;
+    uint32_t width, height;
+    if (
+        size < pos || memcmp(data, CaptureMagic, 4) != 0 || data[4] != CaptureVersion ||
+        readVarint(data, size, &pos, &width) || readVarint(data, size, &pos, &height) ||
+        width == 0
+    ) {
+        fprintf(stderr, "Error: not a capture file\n");
+        free(data);
+        return 2;
+    }
+
+    Renderer r;
+    if (initRenderer(&r) != 0) {
+        free(data);
+        return 1;
+    }
+    initInput();
+
+    int status;
+    uint32_t deltaMs;
+    Key key = NoKey;
+    while ((status = playFrame(&r, data, size, &pos, width, &deltaMs)) == 1) {
+        if (speed > 0) sleepSeconds(deltaMs / 1000.0 / speed);
+        draw(&r);
+
+        getChar(&key);
+        if (key == KESC) break;
+    }
+    clear();
+
+    deinitInput();
+    deinitRenderer(&r);
+    free(data);
+
+    if (status == -1) {
+        fprintf(stderr, "Error: malformed capture at byte %zu\n", pos);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "replay.h"
+
+
+static double elapsedMs(clock_t start) {
+    return (double)(clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
+static void printBoard(const GameState *state) {
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        uint16_t row = getBoardRow(state, y);
+        putchar('|');
+        for (int x = 0; x < GAME_WIDTH; x++) {
+            putchar((row >> x) & 1 ? '#' : '.');
+        }
+        printf("|\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    int seekPiece = -1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seek") == 0 && i + 1 < argc) {
+            seekPiece = atoi(argv[++i]);
+        } else if (path == NULL) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "Usage: %s <replay> [--seek <piece>]\n", argv[0]);
+        return 2;
+    }
+
+    size_t size;
+    uint8_t *data = readWholeFile(path, &size);
+    if (data == NULL) {
+        perror("Error reading replay");
+        return 2;
+    }
+
+    initGame();
+
+    ReplayReader rd;
+    if (openReplayReader(&rd, data, size) != 0) {
+        fprintf(stderr, "Error: not a replay file\n");
+        free(data);
+        return 2;
+    }
+
+    printf("Replay:    %s (%zu bytes, seed %u, %d keyframes)\n", path, size, rd.seed, rd.keyframes);
+
+    GameState state;
+    int error;
+    if (seekPiece >= 0) {
+        clock_t start = clock();
+        error = seekReplay(&rd, &state, seekPiece);
+        if (!error) {
+            printf("Seek:      piece %d at %.1f s in %.3f ms\n", rd.pieces, rd.time / 1000.0, elapsedMs(start));
+            printBoard(&state);
+            while ((error = stepReplay(&rd, &state)) == 1) {}
+            error = error != 0;
+        }
+    } else {
+        clock_t start = clock();
+        error = simulateReplay(&rd, &state);
+        printf("Simulated: %.3f ms\n", elapsedMs(start));
+    }
+
+    if (error) {
+        fprintf(stderr, "Error: malformed replay at byte %zu\n", rd.pos);
+        free(data);
+        return 2;
+    }
+
+    printf("Duration:  %.1f s, %d pieces\n", rd.time / 1000.0, rd.pieces);
+    printf("Score:     %d (recorded %d)\n", state.score, rd.result.score);
+
+    bool match = replayMatches(&state, &rd.result);
+    printf("%s\n", match ? "OK" : "MISMATCH");
+
+    free(data);
+    return match ? 0 : 1;
+}
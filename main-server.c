@@ -0,0 +1,381 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+
+#include "game.h"
+#include "replay.h"
+#include "spectator.h"
+
+
+// Every game is one SOCK_SEQPACKET connection: clients send messages of
+// input bytes (ReplayEventType moves), the server answers with the spectator
+// stream of that game (a keyframe, then deltas).
+#define GravityMs        1000
+#define WheelTickMs      10
+#define WheelSlots       128 // must cover GravityMs / WheelTickMs
+#define MaxEvents        256
+#define MaxThreads       64
+#define NoGame           -1
+#define ListenTag        UINT64_MAX
+#define TimerTag         (UINT64_MAX - 1)
+#define StopTag          (UINT64_MAX - 2)
+
+typedef struct {
+    int fd;               // -1 for a free slot
+    GameState state;
+    GameState sent;       // last state sent to the client
+    uint32_t tick;
+    bool dirty;
+    bool queued;          // in the dirty list, only sendUpdates clears it
+    bool needsKeyframe;
+    int wheelSlot;
+    int next;             // wheel list, or free list for free slots
+    int prev;
+} HostedGame;
+
+typedef struct {
+    int epollFd;
+    int timerFd;
+    int listenFd;
+    HostedGame *games;    // contiguous pool
+    int capacity;
+    int freeList;
+    int active;
+    int wheel[WheelSlots]; // list heads
+    int wheelCursor;
+    uint64_t wheelTicks;
+    int *dirty;
+    int dirtyCount;
+    uint32_t seed;
+} Worker;
+
+static void wheelInsert(Worker *w, int id, int delayMs) {
+    int ticks = (delayMs + WheelTickMs - 1) / WheelTickMs;
+    if (ticks < 1) ticks = 1;
+    if (ticks >= WheelSlots) ticks = WheelSlots - 1;
+
+    HostedGame *game = &w->games[id];
+    int slot = (w->wheelCursor + ticks) % WheelSlots;
+    game->wheelSlot = slot;
+    game->prev = NoGame;
+    game->next = w->wheel[slot];
+    if (game->next != NoGame) w->games[game->next].prev = id;
+    w->wheel[slot] = id;
+}
+
+static void wheelRemove(Worker *w, int id) {
+    HostedGame *game = &w->games[id];
+    if (game->prev != NoGame) w->games[game->prev].next = game->next;
+    else w->wheel[game->wheelSlot] = game->next;
+    if (game->next != NoGame) w->games[game->next].prev = game->prev;
+}
+
+/* A slot closed and reused before sendUpdates is still queued, so each id
+ * is in the list once at most and it never outgrows capacity */
+static void markDirty(Worker *w, int id) {
+    HostedGame *game = &w->games[id];
+    game->dirty = true;
+    if (game->queued) return;
+    game->queued = true;
+    w->dirty[w->dirtyCount++] = id;
+}
+
+// A full worker stops listening so other workers pick up new connections
+static void setListening(Worker *w, bool listening) {
+    struct epoll_event listen = { .events = EPOLLIN | EPOLLEXCLUSIVE, .data.u64 = ListenTag };
+    epoll_ctl(w->epollFd, listening ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, w->listenFd, &listen);
+}
+
+static void closeGame(Worker *w, int id) {
+    HostedGame *game = &w->games[id];
+    wheelRemove(w, id);
+    close(game->fd);
+    game->fd = -1;
+    if (w->freeList == NoGame) setListening(w, true);
+    game->next = w->freeList;
+    w->freeList = id;
+    w->active--;
+}
+
+static void acceptGames(Worker *w) {
+    while (w->freeList != NoGame) {
+        int fd = accept(w->listenFd, NULL, NULL);
+        if (fd == -1) return;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        int id = w->freeList;
+        HostedGame *game = &w->games[id];
+        w->freeList = game->next;
+        w->active++;
+
+        game->fd = fd;
+        game->tick = 0;
+        game->dirty = false;
+        game->needsKeyframe = true;
+        initGameStateSeeded(&game->state, w->seed++);
+        wheelInsert(w, id, GravityMs);
+        markDirty(w, id);
+
+        struct epoll_event event = { .events = EPOLLIN, .data.u64 = id };
+        epoll_ctl(w->epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+    setListening(w, false);
+}
+
+static void readInput(Worker *w, int id) {
+    HostedGame *game = &w->games[id];
+    uint8_t message[64];
+    while (true) {
+        ssize_t size = recv(game->fd, message, sizeof(message), 0);
+        if (size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (size <= 0) {
+            // Queued sends for this game are dropped with it
+            game->dirty = false;
+            closeGame(w, id);
+            return;
+        }
+        for (ssize_t i = 0; i < size; i++) {
+            if (message[i] < Replay_Tick) {
+                applyReplayEvent(&game->state, message[i]);
+            }
+        }
+        markDirty(w, id);
+    }
+}
+
+static void advanceWheel(Worker *w) {
+    uint64_t expirations;
+    if (read(w->timerFd, &expirations, sizeof(expirations)) != sizeof(expirations)) return;
+
+    while (expirations--) {
+        w->wheelCursor = (w->wheelCursor + 1) % WheelSlots;
+        w->wheelTicks++;
+
+        int id = w->wheel[w->wheelCursor];
+        w->wheel[w->wheelCursor] = NoGame;
+        while (id != NoGame) {
+            int next = w->games[id].next;
+            updateGame(&w->games[id].state);
+            markDirty(w, id);
+            wheelInsert(w, id, GravityMs);
+            id = next;
+        }
+    }
+}
+
+static void sendUpdates(Worker *w) {
+    uint8_t message[SpectatorMessageMaxSize];
+    for (int i = 0; i < w->dirtyCount; i++) {
+        int id = w->dirty[i];
+        HostedGame *game = &w->games[id];
+        game->queued = false;
+        // Closed slots are skipped, reused ones send their new game
+        if (!game->dirty || game->fd == -1) continue;
+        game->dirty = false;
+
+        if (!game->needsKeyframe && memcmp(&game->sent, &game->state, sizeof(GameState)) == 0) continue;
+
+        game->tick++;
+        size_t size = game->needsKeyframe
+            ? encodeSpectatorKeyframe(message, &game->state, game->tick)
+            : encodeSpectatorDelta(message, &game->sent, &game->state, game->tick);
+        game->sent = game->state;
+
+        if (send(game->fd, message, size, MSG_DONTWAIT | MSG_NOSIGNAL) != -1) {
+            game->needsKeyframe = false;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            game->needsKeyframe = true;
+        } else {
+            closeGame(w, id);
+        }
+    }
+    w->dirtyCount = 0;
+}
+
+static void *runWorker(void *arg) {
+    Worker *w = arg;
+    struct epoll_event events[MaxEvents];
+
+    while (true) {
+        int count = epoll_wait(w->epollFd, events, MaxEvents, -1);
+        if (count == -1) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            uint64_t tag = events[i].data.u64;
+            if (tag == StopTag) return NULL;
+            if (tag == ListenTag) acceptGames(w);
+            else if (tag == TimerTag) advanceWheel(w);
+            else if (w->games[tag].fd != -1) readInput(w, tag);
+        }
+        sendUpdates(w);
+    }
+    return NULL;
+}
+
+/* stopFd is shared by all workers, it stays readable once written */
+static int initWorker(Worker *w, int listenFd, int stopFd, int capacity, uint32_t seed) {
+    memset(w, 0, sizeof(*w));
+    w->listenFd = listenFd;
+    w->capacity = capacity;
+    w->seed = seed;
+    w->games = calloc(capacity, sizeof(HostedGame));
+    w->dirty = malloc(capacity * sizeof(int));
+    if (w->games == NULL || w->dirty == NULL) return 1;
+
+    for (int i = 0; i < capacity; i++) {
+        w->games[i].fd = -1;
+        w->games[i].next = i + 1 < capacity ? i + 1 : NoGame;
+    }
+    w->freeList = 0;
+    for (int i = 0; i < WheelSlots; i++) {
+        w->wheel[i] = NoGame;
+    }
+
+    w->epollFd = epoll_create1(0);
+    w->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (w->epollFd == -1 || w->timerFd == -1) return 1;
+
+    struct itimerspec interval = {
+        .it_interval = { 0, WheelTickMs * 1000000L },
+        .it_value    = { 0, WheelTickMs * 1000000L }
+    };
+    timerfd_settime(w->timerFd, 0, &interval, NULL);
+
+    struct epoll_event timer = { .events = EPOLLIN, .data.u64 = TimerTag };
+    struct epoll_event stop = { .events = EPOLLIN, .data.u64 = StopTag };
+    // Only one worker wakes up per incoming connection
+    struct epoll_event listen = { .events = EPOLLIN | EPOLLEXCLUSIVE, .data.u64 = ListenTag };
+    if (
+        epoll_ctl(w->epollFd, EPOLL_CTL_ADD, w->timerFd, &timer) == -1 ||
+        epoll_ctl(w->epollFd, EPOLL_CTL_ADD, stopFd, &stop) == -1 ||
+        epoll_ctl(w->epollFd, EPOLL_CTL_ADD, listenFd, &listen) == -1
+    ) return 1;
+    return 0;
+}
+
+static void deinitWorker(Worker *w) {
+    for (int i = 0; i < w->capacity; i++) {
+        if (w->games[i].fd != -1) close(w->games[i].fd);
+    }
+    close(w->timerFd);
+    close(w->epollFd);
+    free(w->games);
+    free(w->dirty);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int maxGames = 10000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            maxGames = atoi(argv[++i]);
+        } else if (path == NULL) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL || threads < 1 || maxGames < 1) {
+        fprintf(stderr, "Usage: %s <socket> [-j <threads>] [-n <max games>]\n", argv[0]);
+        return 2;
+    }
+    if (threads > MaxThreads) threads = MaxThreads;
+
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: socket path too long\n");
+        return 2;
+    }
+    strcpy(address.sun_path, path);
+
+    int listenFd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    unlink(path);
+    if (
+        listenFd == -1 ||
+        bind(listenFd, (struct sockaddr*)&address, sizeof(address)) == -1 ||
+        listen(listenFd, SOMAXCONN) == -1
+    ) {
+        perror("Error listening");
+        return 1;
+    }
+    fcntl(listenFd, F_SETFL, O_NONBLOCK);
+
+    // Workers inherit the mask, only sigwait below takes these signals
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    int stopFd = eventfd(0, EFD_CLOEXEC);
+    if (stopFd == -1) {
+        perror("Error creating stop event");
+        close(listenFd);
+        unlink(path);
+        return 1;
+    }
+
+    initGame();
+    uint32_t seed = time(NULL);
+
+    static Worker workers[MaxThreads];
+    pthread_t ids[MaxThreads];
+    int perWorker = (maxGames + threads - 1) / threads;
+    for (int i = 0; i < threads; i++) {
+        // Seeds are spaced so workers never hand out the same sequence
+        if (initWorker(&workers[i], listenFd, stopFd, perWorker, seed + i * 0x10000000u) != 0) {
+            perror("Error starting worker");
+            return 1;
+        }
+    }
+    int started = 0;
+    while (started < threads && pthread_create(&ids[started], NULL, runWorker, &workers[started]) == 0) {
+        started++;
+    }
+    if (started == threads) {
+        printf("Hosting up to %d games on %d threads at %s\n", perWorker * threads, threads, path);
+        int signal;
+        sigwait(&signals, &signal);
+    } else {
+        fprintf(stderr, "Error starting worker threads\n");
+    }
+
+    uint64_t one = 1;
+    write(stopFd, &one, sizeof(one));
+    for (int i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+
+    int active = 0;
+    for (int i = 0; i < threads; i++) {
+        active += workers[i].active;
+        deinitWorker(&workers[i]);
+    }
+    close(stopFd);
+    close(listenFd);
+    unlink(path);
+    if (started < threads) return 1;
+    printf("Stopped with %d games connected\n", active);
+    return 0;
+}
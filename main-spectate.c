@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "game.h"
+#include "spectator.h"
+#include "view.h"
+#include "terminal/renderer.h"
+#include "terminal/input.h"
+
+
+#define PollDelayMs 50
+
+int main(int argc, char **argv) {
+    // --play sends arrow keys back, for games hosted by tetris-server
+    bool play = argc == 3 && strcmp(argv[2], "--play") == 0;
+    if (argc != 2 && !play) {
+        fprintf(stderr, "Usage: %s <socket> [--play]\n", argv[0]);
+        return 2;
+    }
+
+    int fd = connectSpectator(argv[1]);
+    if (fd == -1) return 1;
+
+    Renderer r;
+    if (initRenderer(&r) != 0) {
+        close(fd);
+        return 1;
+    }
+    initInput();
+    initGame();
+
+    setText(&r, 0, 0, "Score: ", Color_White);
+    char scoreBuffer[12];
+
+    GameState state;
+    bool haveKeyframe = false;
+    int status = 0;
+    Key key = NoKey;
+    while (true) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, PollDelayMs) > 0) {
+            uint8_t message[SpectatorMessageMaxSize];
+            ssize_t size = recv(fd, message, sizeof(message), 0);
+            if (size <= 0) break;
+
+            uint32_t tick;
+            GameState next = state;
+            if (applySpectatorMessage(&next, message, size, &tick) != 0) {
+                status = 1;
+                break;
+            }
+            haveKeyframe |= message[0] == SpectatorKeyframe;
+            if (haveKeyframe) {
+                state = next;
+                sprintf(scoreBuffer, "%d", state.score);
+                setText(&r, 7, 0, scoreBuffer, Color_Bright_White);
+                if (state.gameOver) {
+                    setText(&r, 0, 1, "Game Over", Color_Bright_Red);
+                }
+                drawGame(&r, &state);
+                draw(&r);
+            }
+        }
+
+        getChar(&key);
+        if (key == KESC) break;
+
+        uint8_t event;
+        switch (key) {
+            case KLEFT : event = Replay_Left; break;
+            case KRIGHT: event = Replay_Right; break;
+            case KUP   : event = Replay_Rotate; break;
+            case KDOWN : event = Replay_Down; break;
+            default: event = Replay_End; break;
+        }
+        if (play && event != Replay_End && send(fd, &event, 1, MSG_NOSIGNAL) == -1) break;
+    }
+    clear();
+
+    deinitInput();
+    deinitRenderer(&r);
+    close(fd);
+    if (status != 0) fprintf(stderr, "Error: malformed message from game\n");
+    return status;
+}
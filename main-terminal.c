@@ -1,189 +1,268 @@
 #include <time.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
 
 #include "game.h"
+#include "replay.h"
+#include "repeat.h"
+#include "latency.h"
+#include "hud.h"
+#include "publish.h"
+#include "spectator.h"
+#include "view.h"
 #include "terminal/renderer.h"
 #include "terminal/input.h"
+#include "terminal/events.h"
+#include "terminal/trace.h"
 
 
-typedef struct {
-    clock_t start;
-    clock_t end;
-} Clock;
-bool clockTick(Clock *c, int limit) {
-    c->end = clock();
-    double elapsed_ms = (double)(c->end - c->start) * 1000 / CLOCKS_PER_SEC;
-    if (elapsed_ms >= limit) {
-        c->start = c->end;
-        return true;
-    }
-    return false;
+uint32_t clockMs(uint64_t start) {
+    return (uint32_t)(monotonicMs() - start);
 }
 
-// https://en.wikipedia.org/wiki/List_of_Unicode_characters#Box_Drawing
-const CharacterNT C_Hash = "▒"; // 	█ ▓ ▒ ░
-const CharacterNT C_Space = " ";
-const CharacterNT C_Pipe = "│";
-const CharacterNT C_Dash = "─";
-const CharacterNT C_BoxTL = "┌";
-const CharacterNT C_BoxTR = "┐";
-const CharacterNT C_BoxBL = "└";
-const CharacterNT C_BoxBR = "┘";
-const Renderer_Color BoxColor = Color_White;
-const Renderer_Color PieceColor[NumberOfPieces] = {
-    Color_Red,
-    Color_Green,
-    Color_Yellow,
-    Color_Blue,
-    Color_Magenta,
-    Color_Cyan,
-    Color_White
-};
-
-typedef struct {
-    Renderer *r;
-    int offx;
-    int offy;
-} DrawPieceContext;
-
-void drawPieceCallback(void *vCtx, int pieceIndex, int x, int y) {
-    DrawPieceContext *ctx = (DrawPieceContext*)vCtx;
-    setChar(ctx->r,
-        ctx->offx + x,
-        ctx->offy + y,
-        C_Hash,
-        PieceColor[pieceIndex]
-    );
+static ReplayEventType getKeyMove(Key key) {
+    switch (key) {
+        case KLEFT : return Replay_Left;
+        case KRIGHT: return Replay_Right;
+        case KUP   : return Replay_Rotate;
+        case KDOWN : return Replay_Down;
+        default: return Replay_End;
+    }
 }
 
-void drawPiece(Renderer *r, int offx, int offy, int pieceIndex, int rotation) {
-    DrawPieceContext ctx = {
-        .r = r,
-        .offx = offx,
-        .offy = offy
-    };
-    getPieceDrawInfo(pieceIndex, rotation, &drawPieceCallback, &ctx);
+static void playMove(GameState *state, ReplayWriter *replay, ReplayEventType move, uint64_t startTime) {
+    applyReplayEvent(state, move);
+    recordReplayEvent(replay, move, clockMs(startTime));
 }
 
-void drawBox(Renderer *r, int offx, int offy, int width, int height) {
-    for (int y = 0; y < height; y++) {
-        setChar(r, offx        , offy + y, C_Pipe, BoxColor);
-        setChar(r, offx + width, offy + y, C_Pipe, BoxColor);
+/* Plays every repeat of the held keys due by the given time */
+static void playRepeats(KeyRepeat *repeat, GameState *state, ReplayWriter *replay, uint64_t until, uint64_t startTime) {
+    ReplayEventType move;
+    while ((move = nextRepeatMove(repeat, state, until)) != Replay_End) {
+        playMove(state, replay, move, startTime);
     }
-    for (int x = 0; x < width; x++) {
-        setChar(r, offx + x, offy         , C_Dash, BoxColor);
-        setChar(r, offx + x, offy + height, C_Dash, BoxColor);
-    }
-
-    setChar(r, offx        , offy         , C_BoxTL, BoxColor);
-    setChar(r, offx + width, offy         , C_BoxTR, BoxColor);
-    setChar(r, offx        , offy + height, C_BoxBL, BoxColor);
-    setChar(r, offx + width, offy + height, C_BoxBR, BoxColor);
 }
 
-void drawGame(Renderer *r, GameState *state) {
-    int gameX = (r->width - GAME_WIDTH) / 2;
-    int gameY = (r->height - GAME_HEIGHT) / 2;
-
-    // Game Map
-    for (int i = 0; i < GAME_WIDTH * GAME_HEIGHT; i++) {
-        int x = i % GAME_WIDTH;
-        int y = i / GAME_WIDTH;
-        setChar(r,
-            gameX + x,
-            gameY + y,
-            state->map[i] ? C_Hash : C_Space,
-            Color_Bright_Black
-        );
-    }
-
-    // Active piece
-    drawPiece(r, gameX + state->x, gameY + state->y, state->pieceIndex, state->rotation);
+// Keys applied since the last draw, their latency is known once it flushed.
+// Keys past this in one frame go unmeasured.
+#define MaxPendingKeys 1024
 
-    // Game Box
-    drawBox(r, gameX - 1, gameY - 1, GAME_WIDTH + 1, GAME_HEIGHT + 1);
-
-    int nextPieceX = gameX + GAME_WIDTH + 3;
-    // Clear next piece area
-    for (int y = 0; y < 6; y++) {
-        for (int x = 0; x < 8; x++) {
-            setChar(r, nextPieceX - 1 + x, gameY - 1 + y, " ", Color_Reset);
-        }
+/* Closes the outputs opened before the game loop, on errors as on exit.
+ * The replay ends with the state so far, so it stays a complete file. */
+static void closeOutputs(ReplayWriter *replay, Publisher *publisher, SpectatorServer *spectators, const GameState *state, uint64_t startTime) {
+    if (replay->file != NULL) {
+        closeReplayWriter(replay, state, clockMs(startTime));
     }
+    closePublisher(publisher);
+    closeSpectatorServer(spectators);
+}
 
-    // New Piece Box
-    drawBox(r,
-        nextPieceX - 1,
-        gameY - 1,
-        getWidthOfPiece(state->nextPieceIndex, 0) + 3,
-        getHeightOfPiece(state->nextPieceIndex, 0) + 3
-    );
-
-    // Next piece
-    drawPiece(r, nextPieceX + 1, gameY + 1, state->nextPieceIndex, 0);
+static volatile sig_atomic_t reportRequested = 0;
+static void onReportSignal(int number) {
+    (void)number;
+    reportRequested = 1;
 }
 
-#define LoopDelay    50
 #define UpdateDelay  1000
 #define DrawAllDelay 1000
-int main() {
+int main(int argc, char **argv) {
+    const char *recordPath = NULL;
+    const char *capturePath = NULL;
+    const char *publishName = NULL;
+    const char *spectatePath = NULL;
+    const char *latencyPath = NULL;
+    bool hudVisible = false;
+    RepeatConfig repeatConfig = { .das = DefaultDas, .arr = DefaultArr, .dropArr = DefaultDropArr };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capturePath = argv[++i];
+        } else if (strcmp(argv[i], "--publish") == 0 && i + 1 < argc) {
+            publishName = argv[++i];
+        } else if (strcmp(argv[i], "--spectate") == 0 && i + 1 < argc) {
+            spectatePath = argv[++i];
+        } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            latencyPath = argv[++i];
+        } else if (strcmp(argv[i], "--hud") == 0) {
+            hudVisible = true;
+        } else if (strcmp(argv[i], "--das") == 0 && i + 1 < argc) {
+            repeatConfig.das = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--arr") == 0 && i + 1 < argc) {
+            repeatConfig.arr = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--record <replay>] [--capture <session>] [--publish <shm name>] [--spectate <socket>] [--latency <report>] [--hud] [--das <ms>] [--arr <ms>]\n", argv[0]);
+            return 1;
+        }
+    }
+
     Renderer r;
     if (initRenderer(&r) != 0) {
         return 1;
     };
+    if (capturePath != NULL && startCapture(&r, capturePath) != 0) {
+        deinitRenderer(&r);
+        return 1;
+    }
     initInput();
     initGame();
 
+    uint32_t seed = rand();
     GameState state;
-    initGameState(&state);
+    initGameStateSeeded(&state, seed);
 
-    Clock loopClock;
-    loopClock.start = clock();
-    Clock updateClock;
-    updateClock.start = clock();
+    uint64_t startTime = monotonicMs();
+    ReplayWriter replay = { .file = NULL };
+    Publisher publisher = { .ring = NULL };
+    SpectatorServer spectators = { .listenFd = -1 };
+    if (
+        (recordPath != NULL && openReplayWriter(&replay, recordPath, seed) != 0) ||
+        (publishName != NULL && openPublisher(&publisher, publishName) != 0) ||
+        (spectatePath != NULL && openSpectatorServer(&spectators, spectatePath) != 0)
+    ) {
+        closeOutputs(&replay, &publisher, &spectators, &state, startTime);
+        deinitInput();
+        deinitRenderer(&r);
+        return 1;
+    }
+
+    // Keys are read and timestamped as they arrive, whatever this thread does
+    startInputThread();
+    // Held keys repeat here when the terminal reports releases, otherwise
+    // its own key repeat sends presses as before
+    enableKeyReleases();
+    KeyRepeat repeat;
+    initKeyRepeat(&repeat, repeatConfig);
+    EventLoop loop;
+    if (initEventLoop(&loop, getInputFd(), spectators.listenFd) != 0) {
+        closeOutputs(&replay, &publisher, &spectators, &state, startTime);
+        deinitInput();
+        deinitRenderer(&r);
+        return 1;
+    }
+    // Key arrival to flushed frame, reported on exit and on SIGUSR1
+    LatencyHistogram latency;
+    initLatency(&latency);
+    uint64_t pendingKeys[MaxPendingKeys];
+    int pendingCount = 0;
+    #ifdef SIGUSR1
+        // Stays installed after delivery and interrupts the wait, without
+        // SA_RESTART, so the report is written at once
+        struct sigaction action = { .sa_handler = onReportSignal };
+        if (latencyPath != NULL) sigaction(SIGUSR1, &action, NULL);
+    #endif
+    // Toggled with tab, counts all the time so it shows numbers at once
+    PerfHud hud;
+    initHud(&hud, hudVisible, monotonicMs());
+
+    // Gravity deadlines advance by a fixed step, late wakeups do not add up
+    uint64_t nextUpdate = startTime + UpdateDelay;
     // Clock drawClock;
     // drawClock.start = clock();
 
     setText(&r, 0, 0, "Score: ", Color_White);
     char scoreBuffer[12];
 
-    Key chr;
-    while (true) {
-        if (!clockTick(&loopClock, LoopDelay)) continue;
-        getChar(&chr);
-        if (chr == KESC) break;
-        switch (chr) {
-            case KLEFT : moveLeft(&state); break;
-            case KRIGHT: moveRight(&state); break;
-            case KUP   : rotate(&state); break;
-            case KDOWN : moveDown(&state); break;
-            default: break;
+    bool quit = false;
+    while (!quit) {
+        uint64_t deadline = nextRepeatTime(&repeat, &state, monotonicMs());
+        if (deadline > nextUpdate) deadline = nextUpdate;
+        if (hud.visible && deadline > hud.windowStart + HudWindowMs) deadline = hud.windowStart + HudWindowMs;
+        // The wait belongs to the frame it wakes up for
+        uint64_t syscallsBefore = r.sink.syscalls + loop.syscalls;
+        int events = waitEvents(&loop, deadline);
+        uint64_t frameStart = monotonicUs();
+        size_t bytesBefore = r.sink.written;
+
+        // Every key that arrived, as soon as it arrived
+        TRACE_BEGIN("input");
+        if (events & Event_Input) recordHudQueue(&hud, getInputQueueDepth());
+        KeyEvent key;
+        while ((events & Event_Input) && getKeyEvent(&key)) {
+            // Repeats due before the key was read come first
+            playRepeats(&repeat, &state, &replay, key.timeUs / 1000, startTime);
+            if (key.key == KESC) {
+                if (key.type != KeyEvent_Press) continue;
+                quit = true;
+                break;
+            }
+            if (key.key == KTAB) {
+                if (key.type == KeyEvent_Press) toggleHud(&hud, &r);
+                continue;
+            }
+
+            ReplayEventType move = getKeyMove(key.key);
+            if (move == Replay_End) continue;
+            if (key.type == KeyEvent_Release) {
+                releaseRepeatKey(&repeat, move, key.timeUs / 1000);
+                continue;
+            }
+            bool releases = keyReleasesReported();
+            if (key.type == KeyEvent_Repeat && releases) continue;
+
+            playMove(&state, &replay, move, startTime);
+            if (releases) pressRepeatKey(&repeat, move, key.timeUs / 1000);
+            if (pendingCount < MaxPendingKeys) pendingKeys[pendingCount++] = key.timeUs;
         }
+        TRACE_END("input");
+        if (quit) break;
+
+        TRACE_BEGIN("update");
+        playRepeats(&repeat, &state, &replay, monotonicMs(), startTime);
 
-        if (clockTick(&updateClock, UpdateDelay)) {
+        if (monotonicMs() >= nextUpdate) {
+            nextUpdate += UpdateDelay;
+            recordReplayEvent(&replay, Replay_Tick, clockMs(startTime));
+            recordHudTick(&hud);
             if (updateGame(&state)) {
-                clearInputBuffer();
+                recordReplayPiece(&replay, &state, clockMs(startTime));
             }
         }
+        TRACE_END("update");
 
         // if (clockTick(&drawClock, DrawAllDelay)) {
         //     clear();
         //     drawAll(&r);
         // }
 
+        publishState(&publisher, &state);
+        broadcastState(&spectators, &state);
+
+        TRACE_BEGIN("layout");
         sprintf(scoreBuffer, "%d", state.score);
         setText(&r, 7, 0, scoreBuffer, Color_Bright_White);
 
         if (state.gameOver) {
             setText(&r, 0, 1, "Game Over", Color_Bright_Red);
         }
-
         drawGame(&r, &state);
+        updateHud(&hud, &r, monotonicMs());
+        TRACE_END("layout");
         draw(&r);
+        recordHudFrame(&hud, monotonicUs() - frameStart, r.changedCount,
+            r.sink.written - bytesBefore, r.sink.syscalls + loop.syscalls - syscallsBefore);
+
+        if (latencyPath != NULL) {
+            uint64_t flushed = monotonicUs();
+            for (int i = 0; i < pendingCount; i++) {
+                recordLatency(&latency, flushed - pendingKeys[i]);
+            }
+            if (reportRequested) {
+                reportRequested = 0;
+                writeLatencyReport(&latency, latencyPath);
+            }
+        }
+        pendingCount = 0;
     }
     clear();
 
+    if (latencyPath != NULL) writeLatencyReport(&latency, latencyPath);
+    TRACE_WRITE(TracePath);
+    deinitEventLoop(&loop);
+    closeOutputs(&replay, &publisher, &spectators, &state, startTime);
     deinitInput();
     deinitRenderer(&r);
     return 0;
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "game.h"
+#include "replay.h"
+#include "archive.h"
+
+
+// Replays claimed per atomic increment, keeps the shared counter off the hot path
+#define VerifyBatch 64
+#define MaxThreads  256
+
+typedef struct {
+    const Archive *archive;
+    atomic_size_t next;
+    atomic_size_t mismatches;
+    atomic_size_t malformed;
+} VerifyJob;
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool verifyReplay(const uint8_t *data, size_t size, int *score, int *recorded) {
+    ReplayReader rd;
+    GameState state;
+    if (openReplayReader(&rd, data, size) != 0 || simulateReplay(&rd, &state) != 0) {
+        *score = *recorded = -1;
+        return false;
+    }
+    *score = state.score;
+    *recorded = rd.result.score;
+    return replayMatches(&state, &rd.result);
+}
+
+static void *verifyWorker(void *arg) {
+    VerifyJob *job = arg;
+    size_t count = job->archive->count;
+
+    while (true) {
+        size_t start = atomic_fetch_add(&job->next, VerifyBatch);
+        if (start >= count) break;
+        size_t end = start + VerifyBatch < count ? start + VerifyBatch : count;
+
+        for (size_t i = start; i < end; i++) {
+            const uint8_t *data;
+            size_t size;
+            int score, recorded;
+            if (getArchiveReplay(job->archive, i, &data, &size) != 0) {
+                atomic_fetch_add(&job->malformed, 1);
+                printf("Replay %zu: bad index entry\n", i);
+                continue;
+            }
+            if (verifyReplay(data, size, &score, &recorded)) continue;
+
+            if (score == -1) {
+                atomic_fetch_add(&job->malformed, 1);
+                printf("Replay %zu: malformed\n", i);
+            } else {
+                atomic_fetch_add(&job->mismatches, 1);
+                printf("Replay %zu: MISMATCH score %d, recorded %d\n", i, score, recorded);
+            }
+        }
+    }
+    return NULL;
+}
+
+static int pack(const char *archivePath, int count, char **paths) {
+    ArchiveWriter w;
+    if (openArchiveWriter(&w, archivePath) != 0) return 1;
+
+    for (int i = 0; i < count; i++) {
+        size_t size;
+        uint8_t *data = readWholeFile(paths[i], &size);
+        if (data == NULL) {
+            perror(paths[i]);
+            closeArchiveWriter(&w);
+            return 1;
+        }
+        int error = appendArchiveReplay(&w, data, size);
+        free(data);
+        if (error) {
+            closeArchiveWriter(&w);
+            return 1;
+        }
+    }
+
+    printf("Packed %d replays into %s\n", count, archivePath);
+    return closeArchiveWriter(&w);
+}
+
+static int check(const char *archivePath, int threads) {
+    Archive archive;
+    if (openArchive(&archive, archivePath) != 0) return 2;
+
+    VerifyJob job = { .archive = &archive };
+    atomic_init(&job.next, 0);
+    atomic_init(&job.mismatches, 0);
+    atomic_init(&job.malformed, 0);
+
+    pthread_t workers[MaxThreads];
+    double start = nowSeconds();
+    // Workers take replays until none are left, any that started check them all
+    int started = 0;
+    while (started < threads && pthread_create(&workers[started], NULL, verifyWorker, &job) == 0) {
+        started++;
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    double elapsed = nowSeconds() - start;
+    if (started == 0) {
+        fprintf(stderr, "Error starting verification threads\n");
+        closeArchive(&archive);
+        return 2;
+    }
+
+    size_t mismatches = atomic_load(&job.mismatches);
+    size_t malformed = atomic_load(&job.malformed);
+    printf("Verified %zu replays on %d threads in %.3f s (%.0f replays/s)\n",
+        archive.count, started, elapsed, archive.count / (elapsed > 0 ? elapsed : 1e-9));
+    printf("%zu mismatches, %zu malformed\n", mismatches, malformed);
+
+    closeArchive(&archive);
+    return mismatches + malformed != 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 4 && strcmp(argv[1], "pack") == 0) {
+        return pack(argv[2], argc - 3, argv + 3);
+    }
+
+    if (argc >= 3 && strcmp(argv[1], "check") == 0) {
+        int threads = sysconf(_SC_NPROCESSORS_ONLN);
+        if (argc == 5 && strcmp(argv[3], "-j") == 0) {
+            threads = atoi(argv[4]);
+        } else if (argc != 3) {
+            threads = 0;
+        }
+
+        if (threads >= 1) {
+            initGame();
+            return check(argv[2], threads < MaxThreads ? threads : MaxThreads);
+        }
+    }
+
+    fprintf(stderr, "Usage: %s pack <archive> <replay>...\n", argv[0]);
+    fprintf(stderr, "       %s check <archive> [-j <threads>]\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "game.h"
+#include "bot.h"
+#include "replay.h"
+#include "netplay.h"
+#include "view.h"
+#include "terminal/renderer.h"
+#include "terminal/input.h"
+
+
+#define BotQueueSize (4 + GAME_WIDTH + GAME_HEIGHT)
+
+// Turns bot placements into one input per tick
+typedef struct {
+    uint32_t pieceRng; // rng value when the current piece was planned
+    uint8_t queue[BotQueueSize];
+    int count;
+    int next;
+} BotDriver;
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint8_t botInput(BotDriver *bot, const GameState *state) {
+    if (state->gameOver) return NetNoInput;
+
+    // The generator advances once per piece, a new value means a new piece
+    if (state->rng != bot->pieceRng) {
+        bot->pieceRng = state->rng;
+        bot->count = 0;
+        bot->next = 0;
+
+        Placement placement = choosePlacement(state);
+        GameState copy = *state;
+        for (int i = 0; i < placement.rotation; i++) {
+            rotate(&copy);
+            bot->queue[bot->count++] = Replay_Rotate;
+        }
+        int dx = placement.x - copy.x;
+        for (int i = 0; i < abs(dx); i++) {
+            bot->queue[bot->count++] = dx < 0 ? Replay_Left : Replay_Right;
+        }
+        for (int i = 0; i < GAME_HEIGHT; i++) {
+            bot->queue[bot->count++] = Replay_Down;
+        }
+    }
+
+    return bot->next < bot->count ? bot->queue[bot->next++] : NetNoInput;
+}
+
+static uint8_t keyInput() {
+    Key key;
+    getChar(&key);
+    switch (key) {
+        case KLEFT : return Replay_Left;
+        case KRIGHT: return Replay_Right;
+        case KUP   : return Replay_Rotate;
+        case KDOWN : return Replay_Down;
+        case KESC  : return NetQuit;
+        default    : return NetNoInput;
+    }
+}
+
+static void drawVersus(Renderer *r, const Netplay *n) {
+    char buffer[64];
+    int gameY = (r->height - GAME_HEIGHT) / 2;
+    for (int p = 0; p < 2; p++) {
+        int gameX = (p * 2 + 1) * r->width / 4 - (GAME_WIDTH + ViewSideWidth) / 2;
+        const GameState *state = &n->state.players[p];
+        drawGameAt(r, state, gameX, gameY);
+
+        snprintf(buffer, sizeof(buffer), "%-8s %6d %s",
+            p == n->localPlayer ? "You" : "Opponent", state->score,
+            state->gameOver ? "Game Over" : "         ");
+        setText(r, gameX - 1, gameY - 3, buffer, p == n->localPlayer ? Color_Bright_White : Color_White);
+    }
+
+    snprintf(buffer, sizeof(buffer), "tick %-8u rollbacks %-6ld ahead %-3d",
+        n->tick, n->rollbacks, (int)(n->tick - 1 - n->confirmedTick));
+    setText(r, 0, r->height - 1, buffer, Color_Bright_Black);
+    draw(r);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s (--host | --join) <socket path | host:port> [--bot] [--headless] [--ticks <n>] [-s <seed>]\n", name);
+}
+
+int main(int argc, char **argv) {
+    const char *address = NULL;
+    bool host = false;
+    bool useBot = false;
+    bool headless = false;
+    long maxTicks = -1;
+    uint32_t seed = time(NULL);
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "--host") == 0 || strcmp(argv[i], "--join") == 0) && i + 1 < argc) {
+            host = strcmp(argv[i], "--host") == 0;
+            address = argv[++i];
+        } else if (strcmp(argv[i], "--bot") == 0) {
+            useBot = true;
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            maxTicks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (address == NULL || (headless && !useBot)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    initGame();
+    Netplay n;
+    if (host ? hostNetplay(&n, address, seed) : joinNetplay(&n, address)) {
+        return 1;
+    }
+
+    Renderer r;
+    if (!headless) {
+        if (initRenderer(&r) != 0) {
+            closeNetplay(&n);
+            return 1;
+        }
+        initInput();
+    }
+
+    BotDriver bot = { .pieceRng = 0 };
+    bool quit = false;
+    double next = nowSeconds();
+    while (!quit) {
+        double remaining;
+        while ((remaining = next - nowSeconds()) > 0 && !n.remoteQuit) {
+            if (pollNetplay(&n, (int)(remaining * 1000) + 1) != 0) break;
+        }
+        if (pollNetplay(&n, 0) != 0 && !n.remoteQuit) break;
+
+        if (maxTicks >= 0 && n.tick >= maxTicks) {
+            if (n.confirmedTick >= maxTicks - 1) break;
+            if (n.remoteQuit) break;
+            pollNetplay(&n, NetTickMs);
+            continue;
+        }
+        if (n.remoteQuit || n.desync) break;
+
+        if (!canAdvanceNetplay(&n)) {
+            // Too far ahead of the remote, wait for its inputs
+            next = nowSeconds() + NetTickMs / 1000.0;
+            continue;
+        }
+
+        uint8_t input = NetNoInput;
+        if (!headless) input = keyInput();
+        if (input == NetQuit) {
+            quit = true;
+        } else {
+            if (useBot) input = botInput(&bot, &n.state.players[n.localPlayer]);
+            advanceNetplay(&n, input);
+        }
+        next += NetTickMs / 1000.0;
+
+        if (!headless) drawVersus(&r, &n);
+    }
+
+    if (!headless) {
+        clear();
+        deinitInput();
+        deinitRenderer(&r);
+    }
+
+    printf("Ticks:     %u (confirmed %lld)\n", n.tick, (long long)n.confirmedTick + 1);
+    printf("Scores:    %d - %d\n", n.state.players[0].score, n.state.players[1].score);
+    printf("Rollbacks: %ld, %ld ticks re-simulated (max %d), %.2f us per rollback\n",
+        n.rollbacks, n.resimulatedTicks, n.maxResimulated,
+        n.rollbacks ? n.rollbackSeconds * 1e6 / n.rollbacks : 0.0);
+    printf("Checksum:  %08x%s\n", checksumVersusState(&n.state), n.desync ? " DESYNC" : "");
+
+    bool desync = n.desync;
+    closeNetplay(&n);
+    return desync ? 3 : 0;
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "game.h"
+#include "bot.h"
+#include "view.h"
+#include "terminal/renderer.h"
+#include "terminal/input.h"
+
+
+#define FrameDelay 0.05
+// Tiles are a score line above a board plus a column of spacing
+#define TileWidth  (ViewBoardWidth + 1)
+#define TileHeight (ViewBoardHeight + 1)
+
+typedef struct {
+    GameState state;
+    GameState drawn; // state at the last redraw
+    bool needsDraw;
+    int games;
+    int countdown;   // frames until the next placement
+    Viewport view;
+} WatchedBoard;
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void sleepSeconds(double seconds) {
+    if (seconds <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - ts.tv_sec) * 1e9);
+    nanosleep(&ts, NULL);
+}
+
+static void drawTile(WatchedBoard *board) {
+    char buffer[TileWidth + 1];
+    snprintf(buffer, sizeof(buffer), "%-4d %6d", board->games, board->state.score);
+    setViewportText(&board->view, 0, 0, buffer, Color_White);
+
+    Viewport inner = getViewport(board->view.r, board->view.x, board->view.y + 1, ViewBoardWidth, ViewBoardHeight);
+    drawBoard(&inner, &board->state);
+    board->drawn = board->state;
+    board->needsDraw = false;
+}
+
+int main(int argc, char **argv) {
+    int count = 0;
+    uint32_t seed = time(NULL);
+    int framesPerPlacement = 4;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            framesPerPlacement = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [-n <boards>] [-s <seed>] [--frames <per placement>]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (framesPerPlacement < 1) framesPerPlacement = 1;
+
+    Renderer r;
+    if (initRenderer(&r) != 0) return 1;
+
+    // As many boards as fit, above a status line
+    int columns = r.width / TileWidth;
+    int rows = (r.height - 1) / TileHeight;
+    if (count <= 0 || count > columns * rows) count = columns * rows;
+    if (count == 0) {
+        deinitRenderer(&r);
+        fprintf(stderr, "Error: terminal too small for a board (%dx%d)\n", TileWidth, TileHeight + 1);
+        return 1;
+    }
+    initInput();
+    initGame();
+
+    WatchedBoard *boards = calloc(count, sizeof(WatchedBoard));
+    if (boards == NULL) {
+        deinitInput();
+        deinitRenderer(&r);
+        fprintf(stderr, "Error allocating %d boards\n", count);
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        WatchedBoard *board = &boards[i];
+        initGameStateSeeded(&board->state, seed + i);
+        board->games = 1;
+        // Staggered so boards do not all move on the same frame
+        board->countdown = 1 + i % framesPerPlacement;
+        board->needsDraw = true;
+        board->view = getViewport(&r, (i % columns) * TileWidth, (i / columns) * TileHeight, TileWidth, TileHeight);
+    }
+    uint32_t nextSeed = seed + count;
+
+    Viewport statusLine = getViewport(&r, 0, r.height - 1, r.width, 1);
+    char status[128];
+    long placements = 0;
+    double start = nowSeconds();
+    double next = start;
+    Key key = NoKey;
+    while (true) {
+        getChar(&key);
+        if (key == KESC) break;
+
+        int redrawn = 0;
+        for (int i = 0; i < count; i++) {
+            WatchedBoard *board = &boards[i];
+            if (--board->countdown == 0) {
+                board->countdown = framesPerPlacement;
+                if (board->state.gameOver) {
+                    initGameStateSeeded(&board->state, nextSeed++);
+                    board->games++;
+                } else {
+                    playPlacement(&board->state, choosePlacement(&board->state));
+                    placements++;
+                }
+            }
+
+            // Untouched boards keep their cells, the renderer diff never sees them
+            if (board->needsDraw || memcmp(&board->state, &board->drawn, sizeof(GameState)) != 0) {
+                drawTile(board);
+                redrawn++;
+            }
+        }
+
+        snprintf(status, sizeof(status), "%d boards  %6.0f placements/s  %4d redrawn",
+            count, placements / (nowSeconds() - start), redrawn);
+        setViewportText(&statusLine, 0, 0, status, Color_Bright_Black);
+        draw(&r);
+
+        next += FrameDelay;
+        sleepSeconds(next - nowSeconds());
+    }
+    clear();
+
+    free(boards);
+    deinitInput();
+    deinitRenderer(&r);
+    return 0;
+}
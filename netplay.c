@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "game.h"
+#include "replay.h"
+#include "netplay.h"
+
+
+#define FNVOffset 2166136261u
+#define FNVPrime  16777619u
+
+static double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void putU32(uint8_t *out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+static uint32_t getU32(const uint8_t *data) {
+    return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+// "host:port" is TCP, anything else a unix socket path
+static int openSocket(const char *address, bool host) {
+    const char *colon = strrchr(address, ':');
+    int fd = -1;
+
+    if (colon == NULL) {
+        struct sockaddr_un un = { .sun_family = AF_UNIX };
+        if (strlen(address) >= sizeof(un.sun_path)) {
+            fprintf(stderr, "Error: socket path too long\n");
+            return -1;
+        }
+        strcpy(un.sun_path, address);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1) return -1;
+        if (host) unlink(address);
+        int error = host
+            ? bind(fd, (struct sockaddr*)&un, sizeof(un)) || listen(fd, 1)
+            : connect(fd, (struct sockaddr*)&un, sizeof(un));
+        if (error) {
+            close(fd);
+            return -1;
+        }
+    } else {
+        char name[256];
+        snprintf(name, sizeof(name), "%.*s", (int)(colon - address), address);
+        struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM, .ai_flags = AI_PASSIVE };
+        struct addrinfo *info;
+        if (getaddrinfo(name[0] ? name : NULL, colon + 1, &hints, &info) != 0) return -1;
+
+        fd = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+        int one = 1;
+        if (fd != -1) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        int error = fd == -1 || (host
+            ? bind(fd, info->ai_addr, info->ai_addrlen) || listen(fd, 1)
+            : connect(fd, info->ai_addr, info->ai_addrlen));
+        freeaddrinfo(info);
+        if (error) {
+            if (fd != -1) close(fd);
+            return -1;
+        }
+    }
+
+    if (host) {
+        int listenFd = fd;
+        fd = accept(listenFd, NULL, NULL);
+        close(listenFd);
+        if (colon == NULL) unlink(address);
+        if (fd == -1) return -1;
+    }
+
+    if (colon != NULL) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+static void initNetplay(Netplay *n, int fd, int localPlayer, uint32_t seed) {
+    memset(n, 0, sizeof(*n));
+    n->fd = fd;
+    n->localPlayer = localPlayer;
+    n->confirmedTick = -1;
+    n->lastChecksumTick = -1;
+    memset(n->inputs, NetNoInput, sizeof(n->inputs));
+    for (int i = 0; i < NetInputWindow; i++) {
+        n->checksumTicks[i] = -1;
+        n->remoteChecksumTicks[i] = -1;
+    }
+    initGameStateSeeded(&n->state.players[0], seed);
+    initGameStateSeeded(&n->state.players[1], seed);
+}
+
+int hostNetplay(Netplay *n, const char *address, uint32_t seed) {
+    int fd = openSocket(address, true);
+    uint8_t hello[4];
+    putU32(hello, seed);
+    if (fd == -1 || send(fd, hello, 4, MSG_NOSIGNAL) != 4) {
+        perror("Error hosting game");
+        if (fd != -1) close(fd);
+        return 1;
+    }
+    initNetplay(n, fd, 0, seed);
+    return 0;
+}
+
+int joinNetplay(Netplay *n, const char *address) {
+    int fd = openSocket(address, false);
+    uint8_t hello[4];
+    if (fd == -1 || recv(fd, hello, 4, MSG_WAITALL) != 4) {
+        perror("Error joining game");
+        if (fd != -1) close(fd);
+        return 1;
+    }
+    initNetplay(n, fd, 1, getU32(hello));
+    return 0;
+}
+
+void closeNetplay(Netplay *n) {
+    if (n->fd == -1) return;
+    uint8_t packet[NetPacketSize] = { 0 };
+    putU32(packet, n->tick);
+    packet[4] = NetQuit;
+    putU32(packet + 5, NetNoChecksum);
+    send(n->fd, packet, NetPacketSize, MSG_NOSIGNAL);
+    close(n->fd);
+    n->fd = -1;
+}
+
+uint32_t checksumVersusState(const VersusState *state) {
+    uint32_t hash = FNVOffset;
+    for (int p = 0; p < 2; p++) {
+        uint8_t snapshot[SnapshotMaxSize];
+        size_t size = encodeSnapshot(snapshot, &state->players[p], 0);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ snapshot[i]) * FNVPrime;
+        }
+    }
+    return hash;
+}
+
+void simulateVersusTick(VersusState *state, const uint8_t inputs[2], uint32_t tick) {
+    for (int p = 0; p < 2; p++) {
+        if (inputs[p] < Replay_Tick) {
+            applyReplayEvent(&state->players[p], inputs[p]);
+        }
+    }
+    if (tick % NetGravityTicks == NetGravityTicks - 1) {
+        updateGame(&state->players[0]);
+        updateGame(&state->players[1]);
+    }
+}
+
+static void compareChecksums(Netplay *n, int64_t tick) {
+    int slot = tick % NetInputWindow;
+    if (n->checksumTicks[slot] != tick || n->remoteChecksumTicks[slot] != tick) return;
+    if (n->checksums[slot] != n->remoteChecksums[slot]) {
+        n->desync = true;
+    }
+}
+
+// Checksums every newly confirmed tick, the state after tick c is the snapshot before c + 1
+static void updateChecksums(Netplay *n) {
+    int64_t last = n->confirmedTick < (int64_t)n->tick - 1 ? n->confirmedTick : (int64_t)n->tick - 1;
+    for (int64_t c = n->lastChecksumTick + 1; c <= last; c++) {
+        if (c + 1 + RollbackWindow < n->tick) continue;
+
+        const VersusState *after = c + 1 == n->tick ? &n->state : &n->snapshots[(c + 1) % RollbackWindow];
+        int slot = c % NetInputWindow;
+        n->checksums[slot] = checksumVersusState(after);
+        n->checksumTicks[slot] = c;
+        compareChecksums(n, c);
+    }
+    if (last > n->lastChecksumTick) n->lastChecksumTick = last;
+}
+
+bool canAdvanceNetplay(const Netplay *n) {
+    return (int64_t)n->tick - n->confirmedTick <= RollbackWindow;
+}
+
+int advanceNetplay(Netplay *n, uint8_t localInput) {
+    int remote = 1 - n->localPlayer;
+    uint8_t *inputs = n->inputs[n->tick % NetInputWindow];
+    inputs[n->localPlayer] = localInput;
+    if ((int64_t)n->tick > n->confirmedTick) {
+        inputs[remote] = NetNoInput; // prediction
+    }
+
+    n->snapshots[n->tick % RollbackWindow] = n->state;
+    simulateVersusTick(&n->state, inputs, n->tick);
+    n->tick++;
+    updateChecksums(n);
+
+    uint8_t packet[NetPacketSize];
+    putU32(packet, n->tick - 1);
+    packet[4] = localInput;
+    if (n->lastChecksumTick >= 0) {
+        putU32(packet + 5, n->lastChecksumTick);
+        putU32(packet + 9, n->checksums[n->lastChecksumTick % NetInputWindow]);
+    } else {
+        putU32(packet + 5, NetNoChecksum);
+        putU32(packet + 9, 0);
+    }
+    if (send(n->fd, packet, NetPacketSize, MSG_NOSIGNAL) != NetPacketSize) {
+        n->remoteQuit = true;
+        return 1;
+    }
+    return 0;
+}
+
+static void rollback(Netplay *n, uint32_t from) {
+    double start = nowSeconds();
+    n->state = n->snapshots[from % RollbackWindow];
+    for (uint32_t t = from; t < n->tick; t++) {
+        n->snapshots[t % RollbackWindow] = n->state;
+        simulateVersusTick(&n->state, n->inputs[t % NetInputWindow], t);
+    }
+
+    int resimulated = n->tick - from;
+    n->rollbacks++;
+    n->resimulatedTicks += resimulated;
+    if (resimulated > n->maxResimulated) n->maxResimulated = resimulated;
+    n->rollbackSeconds += nowSeconds() - start;
+}
+
+/* @return 0 on success, 1 if the connection broke or sent garbage */
+int pollNetplay(Netplay *n, int timeoutMs) {
+    struct pollfd pfd = { .fd = n->fd, .events = POLLIN };
+    int ready = poll(&pfd, 1, timeoutMs > 0 ? timeoutMs : 0);
+    if (ready <= 0) return 0;
+
+    ssize_t size = recv(n->fd, n->receiveBuffer + n->receiveSize, sizeof(n->receiveBuffer) - n->receiveSize, 0);
+    if (size <= 0) {
+        if (size == -1 && (errno == EAGAIN || errno == EINTR)) return 0;
+        n->remoteQuit = true;
+        return 1;
+    }
+    n->receiveSize += size;
+
+    int remote = 1 - n->localPlayer;
+    int64_t mispredicted = -1;
+    int offset = 0;
+    for (; offset + NetPacketSize <= n->receiveSize; offset += NetPacketSize) {
+        const uint8_t *packet = n->receiveBuffer + offset;
+        uint32_t tick = getU32(packet);
+        uint8_t input = packet[4];
+        if (input == NetQuit) {
+            n->remoteQuit = true;
+            continue;
+        }
+        if (tick != n->confirmedTick + 1 || tick >= n->tick + NetInputWindow - RollbackWindow) {
+            n->remoteQuit = true;
+            return 1;
+        }
+
+        uint8_t *slot = &n->inputs[tick % NetInputWindow][remote];
+        if (tick < n->tick && *slot != input && mispredicted == -1) {
+            mispredicted = tick;
+        }
+        *slot = input;
+        n->confirmedTick = tick;
+
+        uint32_t checksumTick = getU32(packet + 5);
+        if (checksumTick != NetNoChecksum) {
+            int index = checksumTick % NetInputWindow;
+            n->remoteChecksums[index] = getU32(packet + 9);
+            n->remoteChecksumTicks[index] = checksumTick;
+            compareChecksums(n, checksumTick);
+        }
+    }
+    memmove(n->receiveBuffer, n->receiveBuffer + offset, n->receiveSize - offset);
+    n->receiveSize -= offset;
+
+    if (mispredicted != -1) {
+        rollback(n, mispredicted);
+    }
+    updateChecksums(n);
+    return 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "game.h"
+
+
+// Deterministic lockstep with rollback for two players. Both sides simulate
+// both boards from the same seed, one input per player per tick. Remote inputs
+// that haven't arrived yet are predicted as NetNoInput; when the real input
+// differs, the state is restored to that tick and re-simulated.
+#define NetTickMs        50
+#define NetGravityTicks  20 // ticks between gravity steps
+#define RollbackWindow   16 // max ticks the local side runs ahead of the remote
+#define NetInputWindow   (RollbackWindow * 2)
+#define NetNoInput       0xFF
+#define NetQuit          0xFE
+#define NetPacketSize    13 // tick:u32 input:u8 checksumTick:u32 checksum:u32
+#define NetNoChecksum    0xFFFFFFFF
+
+typedef struct {
+    GameState players[2];
+} VersusState;
+
+typedef struct {
+    int fd;
+    int localPlayer;
+    uint32_t tick;           // next tick to simulate
+    int64_t confirmedTick;   // every remote input up to here has arrived
+    VersusState state;       // state before tick
+    VersusState snapshots[RollbackWindow]; // state before tick t, at t % RollbackWindow
+    uint8_t inputs[NetInputWindow][2];
+    uint32_t checksums[NetInputWindow]; // of the state after tick t, once confirmed
+    int64_t checksumTicks[NetInputWindow];
+    uint32_t remoteChecksums[NetInputWindow];
+    int64_t remoteChecksumTicks[NetInputWindow];
+    int64_t lastChecksumTick;
+    uint8_t receiveBuffer[NetPacketSize * 64];
+    int receiveSize;
+
+    bool remoteQuit;
+    bool desync;
+    long rollbacks;
+    long resimulatedTicks;
+    int maxResimulated;
+    double rollbackSeconds;
+} Netplay;
+
+
+int hostNetplay(Netplay *n, const char *address, uint32_t seed);
+int joinNetplay(Netplay *n, const char *address);
+void closeNetplay(Netplay *n);
+
+uint32_t checksumVersusState(const VersusState *state);
+void simulateVersusTick(VersusState *state, const uint8_t inputs[2], uint32_t tick);
+
+bool canAdvanceNetplay(const Netplay *n);
+int advanceNetplay(Netplay *n, uint8_t localInput);
+int pollNetplay(Netplay *n, int timeoutMs);
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+#endif
+
+#include "game.h"
+#include "publish.h"
+
+
+#ifdef _WIN32
+
+int openPublisher(Publisher *p, const char *name) {
+    fprintf(stderr, "Error: shared memory publishing needs POSIX shm\n");
+    return 1;
+}
+
+void publishState(Publisher *p, const GameState *state) {}
+void closePublisher(Publisher *p) {}
+
+int openObserver(Observer *o, const char *name) {
+    fprintf(stderr, "Error: shared memory publishing needs POSIX shm\n");
+    return 1;
+}
+
+bool readLatestState(const Observer *o, GameState *state, uint64_t *head) {
+    return false;
+}
+
+void closeObserver(Observer *o) {}
+
+#else
+
+int openPublisher(Publisher *p, const char *name) {
+    p->ring = NULL;
+    snprintf(p->name, sizeof(p->name), "%s", name);
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd == -1) {
+        perror("Error creating shared memory");
+        return 1;
+    }
+    if (ftruncate(fd, sizeof(PublishRing)) == -1) {
+        perror("Error sizing shared memory");
+        close(fd);
+        shm_unlink(name);
+        return 1;
+    }
+
+    void *map = mmap(NULL, sizeof(PublishRing), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error mapping shared memory");
+        shm_unlink(name);
+        return 1;
+    }
+
+    p->ring = map;
+    memset(p->ring, 0, sizeof(PublishRing));
+    p->ring->stateSize = sizeof(GameState);
+    p->ring->slots = PublishSlots;
+    p->ring->version = PublishVersion;
+    // Readers check the magic last
+    atomic_thread_fence(memory_order_release);
+    p->ring->magic = PublishMagic;
+
+    memset(&p->last, 0, sizeof(GameState));
+    return 0;
+}
+
+// Skips states identical to the last published one
+void publishState(Publisher *p, const GameState *state) {
+    if (p->ring == NULL) return;
+    uint64_t head = atomic_load_explicit(&p->ring->head, memory_order_relaxed);
+    if (head != 0 && memcmp(&p->last, state, sizeof(GameState)) == 0) return;
+    p->last = *state;
+
+    PublishSlot *slot = &p->ring->slot[head % PublishSlots];
+    uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&slot->state, state, sizeof(GameState));
+    atomic_store_explicit(&slot->sequence, sequence + 2, memory_order_release);
+
+    atomic_store_explicit(&p->ring->head, head + 1, memory_order_release);
+}
+
+void closePublisher(Publisher *p) {
+    if (p->ring == NULL) return;
+    munmap(p->ring, sizeof(PublishRing));
+    shm_unlink(p->name);
+    p->ring = NULL;
+}
+
+int openObserver(Observer *o, const char *name) {
+    o->ring = NULL;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) {
+        perror("Error opening shared memory");
+        return 1;
+    }
+
+    void *map = mmap(NULL, sizeof(PublishRing), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error mapping shared memory");
+        return 1;
+    }
+
+    o->ring = map;
+    if (
+        o->ring->magic != PublishMagic || o->ring->version != PublishVersion ||
+        o->ring->stateSize != sizeof(GameState) || o->ring->slots != PublishSlots
+    ) {
+        fprintf(stderr, "Error: incompatible game state publisher\n");
+        closeObserver(o);
+        return 1;
+    }
+    return 0;
+}
+
+/* @return A consistent state was read, head is the number of states published */
+bool readLatestState(const Observer *o, GameState *state, uint64_t *head) {
+    uint64_t published = atomic_load_explicit(&o->ring->head, memory_order_acquire);
+
+    // Walk back from the newest slot if the writer laps the one being read
+    for (uint64_t age = 1; age <= PublishSlots && age <= published; age++) {
+        const PublishSlot *slot = &o->ring->slot[(published - age) % PublishSlots];
+        uint32_t before = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (before & 1) continue;
+
+        memcpy(state, (const void*)&slot->state, sizeof(GameState));
+        atomic_thread_fence(memory_order_acquire);
+        uint32_t after = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+        if (before == after) {
+            *head = published - age + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+void closeObserver(Observer *o) {
+    if (o->ring == NULL) return;
+    munmap((void*)o->ring, sizeof(PublishRing));
+    o->ring = NULL;
+}
+
+#endif
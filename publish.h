@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "game.h"
+
+
+// Shared memory ring of GameState snapshots. The writer never waits: every
+// slot is guarded by a sequence lock, readers retry or fall back to an older
+// slot when they catch a slot mid-write.
+#define PublishMagic   0x54525348 // "TRSH"
+#define PublishVersion 1
+#define PublishSlots   8
+
+typedef struct {
+    _Atomic uint32_t sequence; // odd while the state is being written
+    GameState state;
+} PublishSlot;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t stateSize;
+    uint32_t slots;
+    _Atomic uint64_t head; // number of states published so far
+    PublishSlot slot[PublishSlots];
+} PublishRing;
+
+typedef struct {
+    PublishRing *ring;
+    char name[64];
+    GameState last;
+} Publisher;
+
+typedef struct {
+    const PublishRing *ring;
+} Observer;
+
+
+int openPublisher(Publisher *p, const char *name);
+void publishState(Publisher *p, const GameState *state);
+void closePublisher(Publisher *p);
+
+int openObserver(Observer *o, const char *name);
+bool readLatestState(const Observer *o, GameState *state, uint64_t *head);
+void closeObserver(Observer *o);
@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "replay.h"
+#include "repeat.h"
+
+
+#define RepeatLeft  0
+#define RepeatRight 1
+#define RepeatDown  2
+
+static const ReplayEventType RepeatMove[RepeatKeys] = { Replay_Left, Replay_Right, Replay_Down };
+
+void initKeyRepeat(KeyRepeat *k, RepeatConfig config) {
+    k->config = config;
+    for (int i = 0; i < RepeatKeys; i++) {
+        k->keys[i].held = false;
+        k->keys[i].nextTime = 0;
+    }
+    k->horizontal = -1;
+}
+
+/* @return the key index of a move, -1 for moves that do not repeat */
+static int getRepeatKey(ReplayEventType key) {
+    switch (key) {
+        case Replay_Left : return RepeatLeft;
+        case Replay_Right: return RepeatRight;
+        case Replay_Down : return RepeatDown;
+        default: return -1;
+    }
+}
+
+static bool isRepeating(const KeyRepeat *k, int index) {
+    return k->keys[index].held && (index == RepeatDown || index == k->horizontal);
+}
+
+static uint32_t getRepeatDelay(const KeyRepeat *k, int index) {
+    return index == RepeatDown ? k->config.dropArr : k->config.arr;
+}
+
+void pressRepeatKey(KeyRepeat *k, ReplayEventType key, uint64_t time) {
+    int index = getRepeatKey(key);
+    if (index == -1) return;
+
+    k->keys[index].held = true;
+    if (index == RepeatDown) {
+        k->keys[index].nextTime = time + k->config.dropArr;
+    } else {
+        k->keys[index].nextTime = time + k->config.das;
+        k->horizontal = index;
+    }
+}
+
+void releaseRepeatKey(KeyRepeat *k, ReplayEventType key, uint64_t time) {
+    int index = getRepeatKey(key);
+    if (index == -1 || !k->keys[index].held) return;
+
+    k->keys[index].held = false;
+    if (index != k->horizontal) return;
+
+    // The other direction takes over when still held, charging from here
+    int other = index == RepeatLeft ? RepeatRight : RepeatLeft;
+    k->horizontal = -1;
+    if (k->keys[other].held) {
+        k->horizontal = other;
+        k->keys[other].nextTime = time + k->config.das;
+    }
+}
+
+static bool wouldMove(const GameState *state, ReplayEventType move) {
+    GameState next = *state;
+    applyReplayEvent(&next, move);
+    return next.x != state->x || next.y != state->y;
+}
+
+/* Takes the earliest repeat due by now that moves the piece. Repeats that
+ * would not move it are used up, except with a delay of 0, which keeps
+ * pushing for as long as the key is held. Call until it returns Replay_End,
+ * applying each move, to catch up on everything due.
+ * @return the move, Replay_End when none is due */
+ReplayEventType nextRepeatMove(KeyRepeat *k, const GameState *state, uint64_t now) {
+    int blocked = 0; // keys with a delay of 0 that hit the wall this call
+    while (true) {
+        int due = -1;
+        for (int i = 0; i < RepeatKeys; i++) {
+            if (!isRepeating(k, i) || (blocked >> i & 1) || k->keys[i].nextTime > now) continue;
+            if (due == -1 || k->keys[i].nextTime < k->keys[due].nextTime) due = i;
+        }
+        if (due == -1) return Replay_End;
+
+        ReplayEventType move = RepeatMove[due];
+        bool moves = wouldMove(state, move);
+        uint32_t delay = getRepeatDelay(k, due);
+        if (delay == 0) {
+            if (moves) return move;
+            blocked |= 1 << due;
+            continue;
+        }
+
+        k->keys[due].nextTime += delay;
+        if (moves) return move;
+    }
+}
+
+/* Keys with a delay of 0 that are pushing against the wall are not waited
+ * for, they move again once something else changed the state
+ * @return when the next repeat is due, UINT64_MAX when none is */
+uint64_t nextRepeatTime(const KeyRepeat *k, const GameState *state, uint64_t now) {
+    uint64_t next = UINT64_MAX;
+    for (int i = 0; i < RepeatKeys; i++) {
+        if (!isRepeating(k, i) || k->keys[i].nextTime >= next) continue;
+        if (k->keys[i].nextTime <= now && getRepeatDelay(k, i) == 0 && !wouldMove(state, RepeatMove[i])) continue;
+        next = k->keys[i].nextTime;
+    }
+    return next;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "replay.h"
+
+
+// Key repeat driven by press and release times, the same for every frontend.
+// Left and right repeat after das ms every arr ms, an arr of 0 moves to the
+// wall at once. Down repeats every dropArr ms from the press. Of left and
+// right only the last pressed repeats. The first move of a press is the
+// caller's, repeats follow from there.
+#define DefaultDas     170
+#define DefaultArr     50
+#define DefaultDropArr 50
+
+typedef struct {
+    uint32_t das;
+    uint32_t arr;
+    uint32_t dropArr;
+} RepeatConfig;
+
+typedef struct {
+    bool held;
+    uint64_t nextTime; // of the next repeat
+} RepeatKey;
+
+// Indexed by RepeatLeft, RepeatRight and RepeatDown
+#define RepeatKeys 3
+
+typedef struct {
+    RepeatConfig config;
+    RepeatKey keys[RepeatKeys];
+    int horizontal; // key index of left or right that repeats, -1 for neither
+} KeyRepeat;
+
+
+void initKeyRepeat(KeyRepeat *k, RepeatConfig config);
+void pressRepeatKey(KeyRepeat *k, ReplayEventType key, uint64_t time);
+void releaseRepeatKey(KeyRepeat *k, ReplayEventType key, uint64_t time);
+ReplayEventType nextRepeatMove(KeyRepeat *k, const GameState *state, uint64_t now);
+uint64_t nextRepeatTime(const KeyRepeat *k, const GameState *state, uint64_t now);
@@ -0,0 +1,351 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "replay.h"
+
+
+#define VarintMaxSize 5
+
+// LEB128: 7 bits per byte, high bit set on all but the last byte
+size_t writeVarint(uint8_t *out, uint32_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = value;
+    return n;
+}
+
+int readVarint(const uint8_t *data, size_t size, size_t *pos, uint32_t *out) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 7 * VarintMaxSize; shift += 7) {
+        if (*pos >= size) return 1;
+        uint8_t byte = data[(*pos)++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *out = value;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int writeBytes(ReplayWriter *w, const void *data, size_t n) {
+    w->offset += n;
+    return fwrite(data, 1, n, w->file) != n;
+}
+
+static int writeVarintToFile(ReplayWriter *w, uint32_t value) {
+    uint8_t buffer[VarintMaxSize];
+    return writeBytes(w, buffer, writeVarint(buffer, value));
+}
+
+static int writeU32(ReplayWriter *w, uint32_t value) {
+    uint8_t buffer[4] = { value, value >> 8, value >> 16, value >> 24 };
+    return writeBytes(w, buffer, 4);
+}
+
+static uint32_t readU32(const uint8_t *data) {
+    return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+int openReplayWriter(ReplayWriter *w, const char *path, uint32_t seed) {
+    w->file = fopen(path, "wb");
+    if (w->file == NULL) {
+        perror("Error opening replay file");
+        return 1;
+    }
+    w->lastTime = 0;
+    w->offset = 0;
+    w->pieces = 0;
+    w->index = NULL;
+    w->keyframes = 0;
+    w->indexCapacity = 0;
+
+    uint8_t version = ReplayVersion;
+    if (
+        writeBytes(w, ReplayMagic, ReplayMagicSize) ||
+        writeBytes(w, &version, 1) ||
+        writeVarintToFile(w, seed)
+    ) {
+        perror("Error writing replay header");
+        fclose(w->file);
+        w->file = NULL;
+        return 1;
+    }
+    return 0;
+}
+
+int recordReplayEvent(ReplayWriter *w, ReplayEventType type, uint32_t time) {
+    if (w->file == NULL) return 1;
+    if (time < w->lastTime) time = w->lastTime;
+
+    uint32_t delta = time - w->lastTime;
+    w->lastTime = time;
+    return writeVarintToFile(w, delta << ReplayTypeBits | type);
+}
+
+// Called after a tick placed a piece, writes a keyframe every ReplayKeyframeInterval pieces
+int recordReplayPiece(ReplayWriter *w, const GameState *state, uint32_t time) {
+    if (w->file == NULL) return 1;
+    w->pieces++;
+    if (w->pieces % ReplayKeyframeInterval != 0) return 0;
+
+    if (w->keyframes == w->indexCapacity) {
+        int capacity = w->indexCapacity ? w->indexCapacity * 2 : 16;
+        uint32_t *temp = realloc(w->index, capacity * 2 * sizeof(uint32_t));
+        if (temp == NULL) return 1;
+        w->index = temp;
+        w->indexCapacity = capacity;
+    }
+
+    int error = recordReplayEvent(w, Replay_Keyframe, time);
+    w->index[w->keyframes * 2 + 0] = w->offset;
+    w->index[w->keyframes * 2 + 1] = w->lastTime;
+    w->keyframes++;
+
+    uint8_t snapshot[SnapshotMaxSize];
+    error |= writeBytes(w, snapshot, encodeSnapshot(snapshot, state, w->pieces));
+    return error;
+}
+
+int closeReplayWriter(ReplayWriter *w, const GameState *state, uint32_t time) {
+    if (w->file == NULL) return 1;
+
+    int error = recordReplayEvent(w, Replay_End, time);
+    error |= writeVarintToFile(w, state->score);
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        error |= writeVarintToFile(w, getBoardRow(state, y));
+    }
+
+    uint32_t indexOffset = w->offset;
+    for (int i = 0; i < w->keyframes * 2; i++) {
+        error |= writeU32(w, w->index[i]);
+    }
+    error |= writeU32(w, indexOffset);
+    error |= writeU32(w, w->keyframes);
+    error |= writeU32(w, ReplayKeyframeInterval);
+    error |= writeBytes(w, ReplayIndexMagic, ReplayMagicSize);
+
+    if (fclose(w->file) != 0) error = 1;
+    w->file = NULL;
+    free(w->index);
+    w->index = NULL;
+    if (error) perror("Error writing replay");
+    return error;
+}
+
+size_t encodeSnapshot(uint8_t *out, const GameState *state, int pieces) {
+    size_t n = 0;
+    n += writeVarint(out + n, pieces);
+    n += writeVarint(out + n, state->x);
+    n += writeVarint(out + n, state->y);
+    n += writeVarint(out + n, state->pieceIndex);
+    n += writeVarint(out + n, state->rotation);
+    n += writeVarint(out + n, state->score);
+    n += writeVarint(out + n, state->gameOver);
+    n += writeVarint(out + n, state->nextPieceIndex);
+    n += writeVarint(out + n, state->rng);
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        n += writeVarint(out + n, getBoardRow(state, y));
+    }
+    return n;
+}
+
+int decodeSnapshot(const uint8_t *data, size_t size, size_t *pos, GameState *state, int *pieces) {
+    uint32_t fields[9];
+    for (int i = 0; i < 9; i++) {
+        if (readVarint(data, size, pos, &fields[i])) return 1;
+    }
+    uint32_t rows[GAME_HEIGHT];
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        if (readVarint(data, size, pos, &rows[y])) return 1;
+    }
+
+    // Reject values that would index outside the piece tables or the map
+    if (
+        fields[3] >= NumberOfPieces || fields[4] > 3 ||
+        fields[7] >= NumberOfPieces ||
+        fields[1] >= GAME_WIDTH || fields[2] >= GAME_HEIGHT
+    ) return 1;
+
+    *pieces = fields[0];
+    state->x = fields[1];
+    state->y = fields[2];
+    state->pieceIndex = fields[3];
+    state->rotation = fields[4];
+    state->score = fields[5];
+    state->gameOver = fields[6];
+    state->nextPieceIndex = fields[7];
+    state->rng = fields[8];
+    state->columnLayout = isColumnLayout(state->rotation);
+    state->pieceWidth = getWidthOfPiece(state->pieceIndex, state->rotation);
+    state->pieceHeight = getHeightOfPiece(state->pieceIndex, state->rotation);
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        setBoardRow(state, y, rows[y]);
+    }
+    return 0;
+}
+
+int openReplayReader(ReplayReader *rd, const uint8_t *data, size_t size) {
+    rd->data = data;
+    rd->size = size;
+    rd->pos = ReplayMagicSize + 1;
+    rd->time = 0;
+    rd->pieces = 0;
+    rd->ended = false;
+    rd->index = NULL;
+    rd->keyframes = 0;
+    rd->keyframeInterval = 0;
+
+    if (size < rd->pos || memcmp(data, ReplayMagic, ReplayMagicSize) != 0) return 1;
+    uint8_t version = data[ReplayMagicSize];
+    if (version < 1 || version > ReplayVersion) return 1;
+    if (readVarint(rd->data, rd->size, &rd->pos, &rd->seed)) return 1;
+    rd->start = rd->pos;
+
+    const uint8_t *footer = data + size - ReplayFooterSize;
+    if (
+        version >= 2 && size >= rd->pos + ReplayFooterSize &&
+        memcmp(footer + 12, ReplayIndexMagic, ReplayMagicSize) == 0
+    ) {
+        uint32_t indexOffset = readU32(footer);
+        uint32_t keyframes = readU32(footer + 4);
+        size_t indexEnd = size - ReplayFooterSize;
+        if (indexOffset > indexEnd || keyframes > (indexEnd - indexOffset) / 8) return 1;
+
+        // The index must not be mistaken for events
+        rd->size = indexOffset;
+        rd->index = data + indexOffset;
+        rd->keyframes = keyframes;
+        rd->keyframeInterval = readU32(footer + 8);
+    }
+    return 0;
+}
+
+/* @return 1 for an event, 0 once the end event was read, -1 on malformed data */
+int nextReplayEvent(ReplayReader *rd, ReplayEvent *event) {
+    if (rd->ended) return 0;
+
+    uint32_t value;
+    if (readVarint(rd->data, rd->size, &rd->pos, &value)) return -1;
+
+    event->type = value & ((1 << ReplayTypeBits) - 1);
+    rd->time += value >> ReplayTypeBits;
+    event->time = rd->time;
+
+    if (event->type == Replay_Keyframe) {
+        // Only needed when seeking, sequential playback already has this state
+        GameState skipped;
+        int pieces;
+        return decodeSnapshot(rd->data, rd->size, &rd->pos, &skipped, &pieces) ? -1 : 1;
+    }
+    if (event->type > Replay_Keyframe) return -1;
+    if (event->type != Replay_End) return 1;
+
+    uint32_t field;
+    if (readVarint(rd->data, rd->size, &rd->pos, &field)) return -1;
+    rd->result.score = field;
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        if (readVarint(rd->data, rd->size, &rd->pos, &field)) return -1;
+        rd->result.rows[y] = field;
+    }
+    rd->ended = true;
+    return 0;
+}
+
+/* @return Piece placed */
+bool applyReplayEvent(GameState *state, ReplayEventType type) {
+    switch (type) {
+        case Replay_Left  : moveLeft(state); break;
+        case Replay_Right : moveRight(state); break;
+        case Replay_Rotate: rotate(state); break;
+        case Replay_Down  : moveDown(state); break;
+        case Replay_Tick  : return updateGame(state);
+        default: break;
+    }
+    return false;
+}
+
+/* @return Same as nextReplayEvent */
+int stepReplay(ReplayReader *rd, GameState *state) {
+    ReplayEvent event;
+    int status = nextReplayEvent(rd, &event);
+    if (status == 1 && applyReplayEvent(state, event.type)) {
+        rd->pieces++;
+    }
+    return status;
+}
+
+// Re-simulates the whole replay from its seed into state
+int simulateReplay(ReplayReader *rd, GameState *state) {
+    initGameStateSeeded(state, rd->seed);
+
+    int status;
+    while ((status = stepReplay(rd, state)) == 1) {}
+    return status != 0;
+}
+
+// Restores the last keyframe at or before piece and simulates up to it.
+// Stops early if the replay ends first, check rd->pieces.
+int seekReplay(ReplayReader *rd, GameState *state, int piece) {
+    int keyframe = -1;
+    if (rd->index != NULL && rd->keyframeInterval > 0) {
+        keyframe = piece / rd->keyframeInterval - 1;
+        if (keyframe >= rd->keyframes) keyframe = rd->keyframes - 1;
+    }
+
+    rd->ended = false;
+    if (keyframe >= 0) {
+        rd->pos = readU32(rd->index + keyframe * 8);
+        rd->time = readU32(rd->index + keyframe * 8 + 4);
+        if (decodeSnapshot(rd->data, rd->size, &rd->pos, state, &rd->pieces)) return 1;
+    } else {
+        rd->pos = rd->start;
+        rd->time = 0;
+        rd->pieces = 0;
+        initGameStateSeeded(state, rd->seed);
+    }
+
+    while (rd->pieces < piece) {
+        int status = stepReplay(rd, state);
+        if (status != 1) return status != 0;
+    }
+    return 0;
+}
+
+bool replayMatches(const GameState *state, const ReplayResult *result) {
+    if (state->score != result->score) return false;
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        if (getBoardRow(state, y) != result->rows[y]) return false;
+    }
+    return true;
+}
+
+uint8_t *readWholeFile(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    uint8_t *data = NULL;
+    long length;
+    if (
+        fseek(file, 0, SEEK_END) == 0 &&
+        (length = ftell(file)) >= 0 &&
+        fseek(file, 0, SEEK_SET) == 0
+    ) {
+        data = malloc(length > 0 ? length : 1);
+        if (data != NULL && fread(data, 1, length, file) != (size_t)length) {
+            free(data);
+            data = NULL;
+        }
+        *size = length;
+    }
+
+    fclose(file);
+    return data;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "game.h"
+
+
+// File layout:
+//   "TRPL" version:u8 seed:varint
+//   events: varint(deltaMs << 3 | type)
+//   keyframe events followed by a snapshot of the state after the last tick
+//   end event followed by score:varint and GAME_HEIGHT board rows:varint
+//   index (version 2): keyframes * { offset:u32, time:u32 }
+//   footer (version 2): indexOffset:u32 keyframes:u32 interval:u32 "TRIX"
+// Integers in the index and footer are little endian, offsets point at the
+// snapshot following a keyframe event.
+#define ReplayMagic      "TRPL"
+#define ReplayIndexMagic "TRIX"
+#define ReplayMagicSize  4
+#define ReplayVersion    2
+#define ReplayTypeBits   3
+#define ReplayFooterSize 16
+#define ReplayKeyframeInterval 20 // pieces
+
+// pieces, x, y, pieceIndex, rotation, score, gameOver, nextPieceIndex, rng, rows
+#define SnapshotMaxSize ((9 + GAME_HEIGHT) * 5)
+
+typedef enum {
+    Replay_Left,   // moveLeft
+    Replay_Right,  // moveRight
+    Replay_Rotate, // rotate
+    Replay_Down,   // moveDown
+    Replay_Tick,   // updateGame (gravity)
+    Replay_End,
+    Replay_Keyframe
+} ReplayEventType;
+
+typedef struct {
+    ReplayEventType type;
+    uint32_t time; // ms since the start of the recording
+} ReplayEvent;
+
+// Outcome stored in the end event
+typedef struct {
+    int score;
+    uint16_t rows[GAME_HEIGHT];
+} ReplayResult;
+
+typedef struct {
+    FILE *file;
+    uint32_t lastTime;
+    uint32_t offset;
+    int pieces;
+    uint32_t *index; // offset, time pairs
+    int keyframes;
+    int indexCapacity;
+} ReplayWriter;
+
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;
+    size_t start; // first event
+    uint32_t seed;
+    uint32_t time;
+    int pieces;
+    bool ended;
+    ReplayResult result;
+
+    const uint8_t *index; // NULL without a trailing index
+    int keyframes;
+    int keyframeInterval;
+} ReplayReader;
+
+
+size_t writeVarint(uint8_t *out, uint32_t value);
+int readVarint(const uint8_t *data, size_t size, size_t *pos, uint32_t *out);
+
+int openReplayWriter(ReplayWriter *w, const char *path, uint32_t seed);
+int recordReplayEvent(ReplayWriter *w, ReplayEventType type, uint32_t time);
+int recordReplayPiece(ReplayWriter *w, const GameState *state, uint32_t time);
+int closeReplayWriter(ReplayWriter *w, const GameState *state, uint32_t time);
+
+size_t encodeSnapshot(uint8_t *out, const GameState *state, int pieces);
+int decodeSnapshot(const uint8_t *data, size_t size, size_t *pos, GameState *state, int *pieces);
+
+int openReplayReader(ReplayReader *rd, const uint8_t *data, size_t size);
+int nextReplayEvent(ReplayReader *rd, ReplayEvent *event);
+
+bool applyReplayEvent(GameState *state, ReplayEventType type);
+int stepReplay(ReplayReader *rd, GameState *state);
+int simulateReplay(ReplayReader *rd, GameState *state);
+int seekReplay(ReplayReader *rd, GameState *state, int piece);
+bool replayMatches(const GameState *state, const ReplayResult *result);
+
+uint8_t *readWholeFile(const char *path, size_t *size);
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+#endif
+
+#include "game.h"
+#include "replay.h"
+#include "spectator.h"
+
+
+size_t encodeSpectatorKeyframe(uint8_t *out, const GameState *state, uint32_t tick) {
+    size_t n = 0;
+    n += writeVarint(out + n, SpectatorKeyframe);
+    n += writeVarint(out + n, tick);
+    n += encodeSnapshot(out + n, state, 0);
+    return n;
+}
+
+size_t encodeSpectatorDelta(uint8_t *out, const GameState *previous, const GameState *state, uint32_t tick) {
+    uint16_t rows[GAME_HEIGHT];
+    uint32_t changed = 0;
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        rows[y] = getBoardRow(state, y);
+        if (rows[y] != getBoardRow(previous, y)) changed |= 1 << y;
+    }
+
+    size_t n = 0;
+    n += writeVarint(out + n, SpectatorDelta);
+    n += writeVarint(out + n, tick);
+    n += writeVarint(out + n, changed);
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        if (changed & (1 << y)) n += writeVarint(out + n, rows[y]);
+    }
+    n += writeVarint(out + n, state->x);
+    n += writeVarint(out + n, state->y);
+    n += writeVarint(out + n, state->pieceIndex);
+    n += writeVarint(out + n, state->rotation);
+    n += writeVarint(out + n, state->nextPieceIndex);
+    n += writeVarint(out + n, state->score);
+    n += writeVarint(out + n, state->gameOver);
+    return n;
+}
+
+/* Deltas change whatever state holds, callers drop them until a keyframe
+ * came in
+ * @return 0 on success, 1 on malformed data */
+int applySpectatorMessage(GameState *state, const uint8_t *data, size_t size, uint32_t *tick) {
+    size_t pos = 0;
+    uint32_t type;
+    if (readVarint(data, size, &pos, &type) || readVarint(data, size, &pos, tick)) return 1;
+
+    if (type == SpectatorKeyframe) {
+        int pieces;
+        return decodeSnapshot(data, size, &pos, state, &pieces);
+    }
+    if (type != SpectatorDelta) return 1;
+
+    uint32_t changed;
+    if (readVarint(data, size, &pos, &changed)) return 1;
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        uint32_t row;
+        if (!(changed & (1 << y))) continue;
+        if (readVarint(data, size, &pos, &row)) return 1;
+        setBoardRow(state, y, row);
+    }
+
+    uint32_t fields[7];
+    for (int i = 0; i < 7; i++) {
+        if (readVarint(data, size, &pos, &fields[i])) return 1;
+    }
+    if (
+        fields[0] >= GAME_WIDTH || fields[1] >= GAME_HEIGHT ||
+        fields[2] >= NumberOfPieces || fields[3] > 3 || fields[4] >= NumberOfPieces
+    ) return 1;
+
+    state->x = fields[0];
+    state->y = fields[1];
+    state->pieceIndex = fields[2];
+    state->rotation = fields[3];
+    state->nextPieceIndex = fields[4];
+    state->score = fields[5];
+    state->gameOver = fields[6];
+    state->columnLayout = isColumnLayout(state->rotation);
+    state->pieceWidth = getWidthOfPiece(state->pieceIndex, state->rotation);
+    state->pieceHeight = getHeightOfPiece(state->pieceIndex, state->rotation);
+    return 0;
+}
+
+#ifdef _WIN32
+
+int openSpectatorServer(SpectatorServer *s, const char *path) {
+    fprintf(stderr, "Error: spectating needs unix domain sockets\n");
+    return 1;
+}
+
+void broadcastState(SpectatorServer *s, const GameState *state) {}
+void closeSpectatorServer(SpectatorServer *s) {}
+
+int connectSpectator(const char *path) {
+    fprintf(stderr, "Error: spectating needs unix domain sockets\n");
+    return -1;
+}
+
+#else
+
+static int makeAddress(struct sockaddr_un *address, const char *path) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address->sun_path)) {
+        fprintf(stderr, "Error: socket path too long\n");
+        return 1;
+    }
+    strcpy(address->sun_path, path);
+    return 0;
+}
+
+int openSpectatorServer(SpectatorServer *s, const char *path) {
+    memset(s, 0, sizeof(*s));
+    s->listenFd = -1;
+    struct sockaddr_un address;
+    if (makeAddress(&address, path) != 0) return 1;
+    strcpy(s->path, path);
+
+    s->listenFd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (s->listenFd == -1) {
+        perror("Error creating spectator socket");
+        return 1;
+    }
+    fcntl(s->listenFd, F_SETFL, O_NONBLOCK);
+    unlink(path);
+    if (
+        bind(s->listenFd, (struct sockaddr*)&address, sizeof(address)) == -1 ||
+        listen(s->listenFd, SOMAXCONN) == -1
+    ) {
+        perror("Error listening for spectators");
+        close(s->listenFd);
+        s->listenFd = -1;
+        return 1;
+    }
+    return 0;
+}
+
+static void acceptSpectators(SpectatorServer *s) {
+    while (true) {
+        int fd = accept(s->listenFd, NULL, NULL);
+        if (fd == -1) return;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+        if (s->count == s->capacity) {
+            int capacity = s->capacity ? s->capacity * 2 : 16;
+            Spectator *temp = realloc(s->spectators, capacity * sizeof(Spectator));
+            if (temp == NULL) {
+                close(fd);
+                return;
+            }
+            s->spectators = temp;
+            s->capacity = capacity;
+        }
+        s->spectators[s->count++] = (Spectator){ .fd = fd, .needsKeyframe = true };
+    }
+}
+
+void broadcastState(SpectatorServer *s, const GameState *state) {
+    if (s->listenFd == -1) return;
+    acceptSpectators(s);
+
+    bool changed = s->tick == 0 || memcmp(&s->last, state, sizeof(GameState)) != 0;
+    uint8_t delta[SpectatorMessageMaxSize];
+    uint8_t keyframe[SpectatorMessageMaxSize];
+    size_t deltaSize = 0;
+    size_t keyframeSize = 0;
+    if (changed) {
+        s->tick++;
+        if (s->tick > 1) deltaSize = encodeSpectatorDelta(delta, &s->last, state, s->tick);
+        s->last = *state;
+    }
+
+    for (int i = 0; i < s->count; i++) {
+        Spectator *spectator = &s->spectators[i];
+        const uint8_t *message = delta;
+        size_t size = deltaSize;
+        if (spectator->needsKeyframe) {
+            if (keyframeSize == 0) keyframeSize = encodeSpectatorKeyframe(keyframe, &s->last, s->tick);
+            message = keyframe;
+            size = keyframeSize;
+        } else if (!changed) {
+            continue;
+        }
+
+        if (send(spectator->fd, message, size, MSG_DONTWAIT | MSG_NOSIGNAL) != -1) {
+            spectator->needsKeyframe = false;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            spectator->needsKeyframe = true;
+        } else {
+            close(spectator->fd);
+            s->spectators[i--] = s->spectators[--s->count];
+        }
+    }
+}
+
+void closeSpectatorServer(SpectatorServer *s) {
+    if (s->listenFd == -1) return;
+    for (int i = 0; i < s->count; i++) {
+        close(s->spectators[i].fd);
+    }
+    free(s->spectators);
+    close(s->listenFd);
+    unlink(s->path);
+    s->listenFd = -1;
+}
+
+int connectSpectator(const char *path) {
+    struct sockaddr_un address;
+    if (makeAddress(&address, path) != 0) return -1;
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd == -1 || connect(fd, (struct sockaddr*)&address, sizeof(address)) == -1) {
+        perror("Error connecting to game");
+        if (fd != -1) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "game.h"
+#include "replay.h"
+
+
+// One SOCK_SEQPACKET message per tick, all varints:
+//   keyframe: SpectatorKeyframe tick snapshot (see encodeSnapshot)
+//   delta:    SpectatorDelta tick changedRows, changed rows top to bottom,
+//             x y pieceIndex rotation nextPieceIndex score gameOver
+// Every spectator receives the same encoded buffer. A spectator whose socket
+// is full misses the delta and gets a keyframe once it drains.
+#define SpectatorKeyframe 0
+#define SpectatorDelta    1
+#define SpectatorMessageMaxSize (2 * 5 + SnapshotMaxSize)
+
+typedef struct {
+    int fd;
+    bool needsKeyframe;
+} Spectator;
+
+typedef struct {
+    int listenFd;
+    char path[108];
+    Spectator *spectators;
+    int count;
+    int capacity;
+    uint32_t tick;
+    GameState last;
+} SpectatorServer;
+
+
+int openSpectatorServer(SpectatorServer *s, const char *path);
+void broadcastState(SpectatorServer *s, const GameState *state);
+void closeSpectatorServer(SpectatorServer *s);
+
+size_t encodeSpectatorKeyframe(uint8_t *out, const GameState *state, uint32_t tick);
+size_t encodeSpectatorDelta(uint8_t *out, const GameState *previous, const GameState *state, uint32_t tick);
+int applySpectatorMessage(GameState *state, const uint8_t *data, size_t size, uint32_t *tick);
+
+int connectSpectator(const char *path);
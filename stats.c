@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "stats.h"
+
+
+void initStats(PlayStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+}
+
+void addPlacementStats(PlayStats *stats, const GameState *before, Placement placement, int lines, const GameState *after) {
+    stats->pieces++;
+    stats->placements[before->pieceIndex][placement.rotation & 3][placement.x % GAME_WIDTH]++;
+    stats->clears[lines < 4 ? lines : 4]++;
+
+    // Visits only filled cells, an empty row costs one load
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        uint16_t row = getBoardRow(after, y);
+        while (row) {
+            stats->occupancy[y][__builtin_ctz(row)]++;
+            row &= row - 1;
+        }
+    }
+}
+
+void addGameStats(PlayStats *stats, long pieces, const GameState *state) {
+    long bucket = pieces / SurvivalBucketPieces;
+    stats->games++;
+    stats->score += state->score;
+    stats->survival[bucket < SurvivalBuckets ? bucket : SurvivalBuckets - 1]++;
+}
+
+void mergeStats(PlayStats *into, const PlayStats *from) {
+    // Only u64 counters, so the struct can be summed as an array
+    uint64_t *a = (uint64_t*)into;
+    const uint64_t *b = (const uint64_t*)from;
+    for (size_t i = 0; i < sizeof(PlayStats) / sizeof(uint64_t); i++) {
+        a[i] += b[i];
+    }
+}
+
+static int writeStatsCsv(const PlayStats *stats, FILE *file) {
+    fprintf(file, "metric,a,b,c,value\n");
+    fprintf(file, "games,,,,%llu\n", (unsigned long long)stats->games);
+    fprintf(file, "pieces,,,,%llu\n", (unsigned long long)stats->pieces);
+    fprintf(file, "score,,,,%llu\n", (unsigned long long)stats->score);
+
+    for (int y = 0; y < GAME_HEIGHT; y++) {
+        for (int x = 0; x < GAME_WIDTH; x++) {
+            fprintf(file, "occupancy,%d,%d,,%llu\n", y, x, (unsigned long long)stats->occupancy[y][x]);
+        }
+    }
+    for (int piece = 0; piece < NumberOfPieces; piece++) {
+        for (int rotation = 0; rotation < 4; rotation++) {
+            for (int x = 0; x < GAME_WIDTH; x++) {
+                uint64_t count = stats->placements[piece][rotation][x];
+                if (count) fprintf(file, "placement,%d,%d,%d,%llu\n", piece, rotation, x, (unsigned long long)count);
+            }
+        }
+    }
+    for (int lines = 0; lines < 5; lines++) {
+        fprintf(file, "clears,%d,,,%llu\n", lines, (unsigned long long)stats->clears[lines]);
+    }
+
+    // Survival curve: games still running after a number of pieces
+    int last = SurvivalBuckets - 1;
+    while (last > 0 && stats->survival[last] == 0) last--;
+    uint64_t alive = stats->games;
+    for (int bucket = 0; bucket <= last; bucket++) {
+        fprintf(file, "survival,%d,,,%llu\n", bucket * SurvivalBucketPieces, (unsigned long long)alive);
+        alive -= stats->survival[bucket];
+    }
+    return ferror(file);
+}
+
+static int writeStatsBinary(const PlayStats *stats, FILE *file) {
+    uint8_t header[9] = {
+        'T', 'R', 'S', 'T', StatsVersion, GAME_HEIGHT, GAME_WIDTH,
+        SurvivalBuckets & 0xFF, SurvivalBuckets >> 8
+    };
+    uint8_t bucketPieces[2] = { SurvivalBucketPieces & 0xFF, SurvivalBucketPieces >> 8 };
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header) || fwrite(bucketPieces, 1, 2, file) != 2) return 1;
+
+    const uint64_t *counters = (const uint64_t*)stats;
+    for (size_t i = 0; i < sizeof(PlayStats) / sizeof(uint64_t); i++) {
+        uint8_t buffer[8];
+        for (int j = 0; j < 8; j++) {
+            buffer[j] = counters[i] >> (j * 8);
+        }
+        if (fwrite(buffer, 1, 8, file) != 8) return 1;
+    }
+    return 0;
+}
+
+int writeStats(const PlayStats *stats, const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        perror("Error opening stats");
+        return 1;
+    }
+
+    size_t length = strlen(path);
+    int error = length >= 4 && strcmp(path + length - 4, ".csv") == 0
+        ? writeStatsCsv(stats, file)
+        : writeStatsBinary(stats, file);
+    error |= fclose(file) != 0;
+    if (error) perror("Error writing stats");
+    return error;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "game.h"
+#include "bot.h"
+
+
+// Aggregated bot behaviour, plain counters so per-thread copies merge by
+// addition. Binary layout, integers little endian:
+//   "TRST" version:u8 height:u8 width:u8 survivalBuckets:u16 bucketPieces:u16
+//   then u64 counters in struct order, without padding
+#define StatsMagic            "TRST"
+#define StatsVersion          1
+#define SurvivalBuckets       1024
+#define SurvivalBucketPieces  10
+
+typedef struct {
+    uint64_t games;
+    uint64_t pieces;
+    uint64_t score;
+    uint64_t occupancy[GAME_HEIGHT][GAME_WIDTH];           // cells filled after each placement
+    uint64_t placements[NumberOfPieces][4][GAME_WIDTH];    // piece, rotation, x
+    uint64_t clears[5];                                    // placements by lines cleared
+    uint64_t survival[SurvivalBuckets];                    // games by length, last bucket open ended
+} PlayStats;
+
+
+void initStats(PlayStats *stats);
+void addPlacementStats(PlayStats *stats, const GameState *before, Placement placement, int lines, const GameState *after);
+void addGameStats(PlayStats *stats, long pieces, const GameState *state);
+void mergeStats(PlayStats *into, const PlayStats *from);
+
+/* Writes CSV when path ends in ".csv", the binary layout otherwise
+ * @return 0 on success */
+int writeStats(const PlayStats *stats, const char *path);
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <poll.h>
+    #include <unistd.h>
+    #include <sys/timerfd.h>
+#endif
+
+#include "events.h"
+
+
+uint64_t monotonicUs() {
+    #ifdef _WIN32
+        LARGE_INTEGER counter, frequency;
+        QueryPerformanceCounter(&counter);
+        QueryPerformanceFrequency(&frequency);
+        return counter.QuadPart / frequency.QuadPart * 1000000 +
+               counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart;
+    #else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    #endif
+}
+
+uint64_t monotonicMs() {
+    return monotonicUs() / 1000;
+}
+
+/* @return 0 on success */
+int initEventLoop(EventLoop *loop, int inputFd, int extraFd) {
+    loop->inputFd = inputFd;
+    loop->syscalls = 0;
+    loop->extraFd = extraFd;
+    #ifdef _WIN32
+        loop->timerFd = -1;
+    #else
+        loop->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (loop->timerFd == -1) {
+            perror("Error creating timer");
+            return 1;
+        }
+    #endif
+    return 0;
+}
+
+/* Waits for input, the extra descriptor or the deadline, whichever is first.
+ * A deadline already passed returns at once.
+ * @return a mask of Event_ bits, 0 when interrupted by a signal */
+int waitEvents(EventLoop *loop, uint64_t deadlineMs) {
+    #ifdef _WIN32
+        uint64_t now = monotonicMs();
+        if (deadlineMs <= now) return Event_Deadline;
+        loop->syscalls++;
+        DWORD result = WaitForSingleObject(GetStdHandle(STD_INPUT_HANDLE), (DWORD)(deadlineMs - now));
+        return result == WAIT_OBJECT_0 ? Event_Input : Event_Deadline;
+    #else
+        struct itimerspec deadline = {
+            .it_value = { deadlineMs / 1000, deadlineMs % 1000 * 1000000L }
+        };
+        // A zero it_value disarms the timer, the deadline is long past anyway
+        if (deadline.it_value.tv_sec == 0 && deadline.it_value.tv_nsec == 0) return Event_Deadline;
+        timerfd_settime(loop->timerFd, TFD_TIMER_ABSTIME, &deadline, NULL);
+        loop->syscalls += 2; // with the poll below
+
+        struct pollfd fds[3] = {
+            { .fd = loop->inputFd, .events = POLLIN },
+            { .fd = loop->timerFd, .events = POLLIN },
+            { .fd = loop->extraFd, .events = POLLIN } // ignored by poll when -1
+        };
+        if (poll(fds, 3, -1) == -1) {
+            if (errno != EINTR) perror("Error waiting for events");
+            return 0;
+        }
+
+        int events = 0;
+        if (fds[0].revents) events |= Event_Input;
+        if (fds[1].revents) {
+            uint64_t expirations;
+            if (read(loop->timerFd, &expirations, sizeof(expirations)) > 0) events |= Event_Deadline;
+            loop->syscalls++;
+        }
+        if (fds[2].revents) events |= Event_Extra;
+        return events;
+    #endif
+}
+
+void deinitEventLoop(EventLoop *loop) {
+    #ifndef _WIN32
+        if (loop->timerFd != -1) close(loop->timerFd);
+        loop->timerFd = -1;
+    #endif
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+
+
+// Blocks until input, another descriptor or a deadline instead of polling in
+// a loop. Deadlines are absolute milliseconds of monotonicMs(), so they do not
+// drift with how long the work between waits took.
+typedef struct {
+    int inputFd; // stdin, or the wakeup of the input thread
+    int timerFd; // armed for the deadline of each wait, -1 on Windows
+    int extraFd; // also waited on when not -1, e.g. a listening socket
+    uint64_t syscalls; // made by waitEvents, for the performance HUD
+} EventLoop;
+
+// Bits of the waitEvents() result
+#define Event_Input    1
+#define Event_Deadline 2
+#define Event_Extra    4
+
+uint64_t monotonicUs();
+uint64_t monotonicMs();
+int initEventLoop(EventLoop *loop, int inputFd, int extraFd);
+int waitEvents(EventLoop *loop, uint64_t deadlineMs);
+void deinitEventLoop(EventLoop *loop);
@@ -1,15 +1,52 @@
 #ifdef _WIN32
     #include <conio.h>
+    #include <windows.h>
 #else
     #include <termios.h>
     #include <unistd.h>
     #include <fcntl.h>
+    #include <poll.h>
+    #include <pthread.h>
+    #include <signal.h>
+    #include <stdatomic.h>
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <time.h>
+    #include <sys/eventfd.h>
 #endif
 
 #include "input.h"
+#include "events.h"
 
 #ifndef _WIN32
     struct termios oldt, newt;
+
+    typedef enum {
+        Parse_Ground,
+        Parse_Escape,
+        Parse_Csi,
+        Parse_Ss3
+    } ParseState;
+
+    // Written only by whoever reads stdin, the input thread when it runs
+    static ParseState parseState = Parse_Ground;
+    static uint64_t escapeTime;
+    static char csiParams[CsiParamsSize + 1];
+    static int csiLength;
+
+    static bool keyFlagsPushed = false;
+    static atomic_bool releasesReported;
+
+    // Single producer, single consumer: the reader pushes, getKeyEvent pops
+    static KeyEvent queue[KeyQueueSize];
+    static atomic_uint queueHead; // next to pop
+    static atomic_uint queueTail; // next to push
+
+    static pthread_t inputThread;
+    static bool threadRunning = false;
+    static int wakeFd = -1; // readable while the thread has queued keys
+    static int stopFd = -1; // readable once the thread should exit
 #endif
 void initInput() {
     #ifndef _WIN32
@@ -27,11 +64,311 @@ void initInput() {
 
 void deinitInput() {
     #ifndef _WIN32
+        stopInputThread();
+        if (keyFlagsPushed) {
+            write(STDOUT_FILENO, TERM_PopKeyFlags, strlen(TERM_PopKeyFlags));
+            keyFlagsPushed = false;
+        }
         // Disable raw mode
         tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
     #endif
 }
 
+#ifndef _WIN32
+static unsigned queuedKeys() {
+    return atomic_load_explicit(&queueTail, memory_order_acquire) -
+           atomic_load_explicit(&queueHead, memory_order_acquire);
+}
+
+/* The reader never pushes more keys than it has room for, see readInput */
+static void pushKey(Key key, KeyEventType type, uint64_t time) {
+    unsigned tail = atomic_load_explicit(&queueTail, memory_order_relaxed);
+    queue[tail % KeyQueueSize] = (KeyEvent){ .key = key, .type = type, .timeUs = time };
+    atomic_store_explicit(&queueTail, tail + 1, memory_order_release);
+}
+
+static bool popKey(KeyEvent *event) {
+    unsigned head = atomic_load_explicit(&queueHead, memory_order_relaxed);
+    if (head == atomic_load_explicit(&queueTail, memory_order_acquire)) return false;
+    *event = queue[head % KeyQueueSize];
+    atomic_store_explicit(&queueHead, head + 1, memory_order_release);
+    return true;
+}
+
+static void pushFinal(unsigned char c, KeyEventType type, uint64_t time) {
+    switch (c) {
+        case UP   : pushKey(KUP   , type, time); break;
+        case LEFT : pushKey(KLEFT , type, time); break;
+        case RIGHT: pushKey(KRIGHT, type, time); break;
+        case DOWN : pushKey(KDOWN , type, time); break;
+        default: break;
+    }
+}
+
+/* Handles a complete CSI sequence, csiParams holds what came before final */
+static void parseCsi(unsigned char final, uint64_t time) {
+    // Reply to TERM_QueryKeyFlags: ESC [ ? flags u
+    if (csiParams[0] == '?') {
+        if (final == 'u') atomic_store(&releasesReported, (atoi(csiParams + 1) & 2) != 0);
+        return;
+    }
+
+    // The event type follows the modifiers: number ; modifiers : type
+    KeyEventType type = KeyEvent_Press;
+    const char *modifiers = strchr(csiParams, ';');
+    const char *event = modifiers != NULL ? strchr(modifiers, ':') : NULL;
+    if (event != NULL) {
+        switch (atoi(event + 1)) {
+            case 2: type = KeyEvent_Repeat; break;
+            case 3: type = KeyEvent_Release; break;
+            default: break;
+        }
+    }
+
+    if (final == 'u') {
+        switch (atoi(csiParams)) {
+            case ESCAPE: pushKey(KESC, type, time); break;
+            case TAB   : pushKey(KTAB, type, time); break;
+            default: break;
+        }
+    } else {
+        pushFinal(final, type, time);
+    }
+}
+
+/* Feeds one byte to the escape sequence parser, pushing at most one key */
+static void parseByte(unsigned char c, uint64_t time) {
+    switch (parseState) {
+        case Parse_Ground:
+            if (c == ESCAPE) {
+                parseState = Parse_Escape;
+                escapeTime = time;
+            } else if (c == TAB) {
+                pushKey(KTAB, KeyEvent_Press, time);
+            }
+            break;
+        case Parse_Escape:
+            if (c == CSI) {
+                parseState = Parse_Csi;
+                csiLength = 0;
+                csiParams[0] = '\0';
+            } else if (c == SS3) {
+                parseState = Parse_Ss3;
+            } else {
+                // No sequence followed, the escape was a key of its own
+                pushKey(KESC, KeyEvent_Press, escapeTime);
+                parseState = Parse_Ground;
+                parseByte(c, time);
+            }
+            break;
+        case Parse_Csi:
+            // Parameter and intermediate bytes, e.g. the modifiers of "1;5A"
+            if (c >= 0x20 && c <= 0x3F) {
+                if (csiLength < CsiParamsSize) {
+                    csiParams[csiLength++] = c;
+                    csiParams[csiLength] = '\0';
+                } else {
+                    csiParams[0] = '!'; // too long, matches nothing
+                }
+                break;
+            }
+            parseState = Parse_Ground;
+            if (c >= 0x40 && c <= 0x7E) {
+                parseCsi(c, time);
+            } else {
+                // Broken sequence, the byte starts over
+                parseByte(c, time);
+            }
+            break;
+        case Parse_Ss3:
+            parseState = Parse_Ground;
+            pushFinal(c, KeyEvent_Press, time);
+            break;
+    }
+}
+
+/* A lone ESC becomes the escape key once no sequence can follow anymore */
+static void flushEscape(uint64_t now) {
+    if (parseState == Parse_Escape && now - escapeTime >= EscapeTimeoutMs * 1000) {
+        pushKey(KESC, KeyEvent_Press, escapeTime);
+        parseState = Parse_Ground;
+    }
+}
+
+/* Reads what stdin has, no more than the queue has room for: every byte
+ * pushes at most one key and a flushed escape one more
+ * @return keys queued, -1 at the end of input */
+static int readInput() {
+    unsigned before = queuedKeys();
+    int room = KeyQueueSize - 1 - (int)before;
+    if (room <= 0) return 0;
+
+    unsigned char buffer[InputChunkSize];
+    int size = room < InputChunkSize ? room : InputChunkSize;
+    ssize_t bytesRead = read(STDIN_FILENO, buffer, size);
+    if (bytesRead == 0) return -1;
+
+    uint64_t now = monotonicUs();
+    for (ssize_t i = 0; i < bytesRead; i++) {
+        parseByte(buffer[i], now);
+    }
+    flushEscape(now);
+    return queuedKeys() - before;
+}
+
+static void *runInputThread(void *arg) {
+    while (true) {
+        // Wait for the game to drain a full queue instead of dropping keys
+        if (queuedKeys() >= KeyQueueSize - 1) {
+            struct timespec wait = { 0, 1000000 };
+            nanosleep(&wait, NULL);
+            continue;
+        }
+
+        int timeout = -1;
+        if (parseState == Parse_Escape) {
+            uint64_t now = monotonicUs();
+            uint64_t deadline = escapeTime + EscapeTimeoutMs * 1000;
+            timeout = deadline > now ? (deadline - now + 999) / 1000 : 0;
+        }
+        struct pollfd fds[2] = {
+            { .fd = STDIN_FILENO, .events = POLLIN },
+            { .fd = stopFd      , .events = POLLIN }
+        };
+        if (poll(fds, 2, timeout) == -1) continue;
+        if (fds[1].revents) break;
+
+        int keys = 0;
+        if (fds[0].revents & POLLIN) {
+            keys = readInput();
+            if (keys < 0) break;
+        } else if (fds[0].revents) {
+            break; // hung up
+        } else {
+            unsigned before = queuedKeys();
+            flushEscape(monotonicUs());
+            keys = queuedKeys() - before;
+        }
+
+        if (keys > 0) {
+            uint64_t one = 1;
+            write(wakeFd, &one, sizeof(one));
+        }
+    }
+    return NULL;
+}
+#endif
+
+/* Reads stdin on a thread of its own from now on, so keys are taken in as
+ * they arrive whatever the game thread is doing. getInputFd() becomes
+ * readable when keys are queued.
+ * @return 0 on success */
+int startInputThread() {
+    #ifdef _WIN32
+        return 1;
+    #else
+        if (threadRunning) return 0;
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wakeFd == -1 || stopFd == -1) {
+            perror("Error creating input events");
+            stopInputThread();
+            return 1;
+        }
+        // Signals are for the game thread, the input thread blocks them all
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+        int error = pthread_create(&inputThread, NULL, runInputThread, NULL);
+        pthread_sigmask(SIG_SETMASK, &old, NULL);
+        if (error != 0) {
+            fprintf(stderr, "Error starting input thread\n");
+            stopInputThread();
+            return 1;
+        }
+        threadRunning = true;
+        return 0;
+    #endif
+}
+
+void stopInputThread() {
+    #ifndef _WIN32
+        if (threadRunning) {
+            uint64_t one = 1;
+            write(stopFd, &one, sizeof(one));
+            pthread_join(inputThread, NULL);
+            threadRunning = false;
+        }
+        if (wakeFd != -1) close(wakeFd);
+        if (stopFd != -1) close(stopFd);
+        wakeFd = -1;
+        stopFd = -1;
+    #endif
+}
+
+/* Asks the terminal to report key releases and repeats. Whether it does
+ * shows in keyReleasesReported() once its reply was read. */
+void enableKeyReleases() {
+    #ifndef _WIN32
+        const char *request = TERM_PushKeyFlags TERM_QueryKeyFlags;
+        write(STDOUT_FILENO, request, strlen(request));
+        keyFlagsPushed = true;
+    #endif
+}
+
+/* @return true when release events can be relied on */
+bool keyReleasesReported() {
+    #ifdef _WIN32
+        return false;
+    #else
+        return atomic_load(&releasesReported);
+    #endif
+}
+
+/* @return the descriptor to wait on for keys */
+int getInputFd() {
+    #ifdef _WIN32
+        return -1;
+    #else
+        return threadRunning ? wakeFd : STDIN_FILENO;
+    #endif
+}
+
+/* @return keys parsed and not taken yet, 0 on Windows */
+int getInputQueueDepth() {
+    #ifdef _WIN32
+        return 0;
+    #else
+        return queuedKeys();
+    #endif
+}
+
+/* Takes the oldest key not handled yet
+ * @return false when there is none */
+bool getKeyEvent(KeyEvent *event) {
+    #ifdef _WIN32
+        Key key = NoKey;
+        getChar(&key);
+        event->key = key;
+        event->type = KeyEvent_Press;
+        event->timeUs = monotonicUs();
+        return key != NoKey;
+    #else
+        if (!threadRunning) {
+            readInput();
+            flushEscape(monotonicUs());
+            return popKey(event);
+        }
+        if (popKey(event)) return true;
+
+        // Reset the wakeup before looking again, keys pushed after this
+        // either get popped now or set it again
+        uint64_t count;
+        read(wakeFd, &count, sizeof(count));
+        return popKey(event);
+    #endif
+}
+
 void getChar(Key *key) {
     #ifdef _WIN32
         if (!_kbhit()) {
@@ -43,6 +380,10 @@ void getChar(Key *key) {
             *key = KESC;
             return;
         }
+        if (ch == TAB) {
+            *key = KTAB;
+            return;
+        }
 
         if (!_kbhit() || (ch != ExtendedCodeA && ch != ExtendedCodeB)) {
             *key = NoKey;
@@ -58,34 +399,24 @@ void getChar(Key *key) {
             default   : *key = NoKey ; return;
         }
     #else
-        char buffer[3];
-        int bytesRead = read(STDIN_FILENO, buffer, 3);
-
-        if (bytesRead < 1 || buffer[0] != ESCAPE) {
-            *key = NoKey;
-            return;
-        }
-
-        if (bytesRead < 2 || buffer[1] != CSI) {
-            *key = KESC;
-            return;
-        }
-
-        switch (buffer[2]) {
-            case UP   : *key = KUP   ; return;
-            case LEFT : *key = KLEFT ; return;
-            case RIGHT: *key = KRIGHT; return;
-            case DOWN : *key = KDOWN ; return;
-            default   : *key = NoKey ; return;
+        // Held keys come as repeated presses, as without release reports
+        KeyEvent event;
+        *key = NoKey;
+        while (getKeyEvent(&event)) {
+            if (event.type != KeyEvent_Release) {
+                *key = event.key;
+                return;
+            }
         }
     #endif
 }
 
+/* Drops every key read so far */
 void clearInputBuffer() {
     #ifdef _WIN32
         while (_kbhit()) _getch();
     #else
-        char ch;
-        while (read(STDIN_FILENO, &ch, 1) > 0) {}
+        KeyEvent event;
+        while (getKeyEvent(&event)) {}
     #endif
 }
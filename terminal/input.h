@@ -1,28 +1,70 @@
 #pragma once
 
+#include <stdint.h>
+#include <stdbool.h>
+
 void initInput();
 void deinitInput();
 
 typedef enum {
-    NoKey, KUP, KLEFT, KRIGHT, KDOWN, KESC
+    NoKey, KUP, KLEFT, KRIGHT, KDOWN, KESC, KTAB
 } Key;
 
+typedef enum {
+    KeyEvent_Press,
+    KeyEvent_Repeat, // sent by the terminal while a key is held
+    KeyEvent_Release
+} KeyEventType;
+
+typedef struct {
+    Key key;
+    KeyEventType type;
+    uint64_t timeUs; // monotonicUs() when the key was read
+} KeyEvent;
+
 #ifdef _WIN32
     #define ExtendedCodeA 0
     #define ExtendedCodeB 224
     #define ESC   27
+    #define TAB   9
     #define UP    72
     #define LEFT  75
     #define RIGHT 77
     #define DOWN  80
 #else
     #define ESCAPE 27
-    #define CSI    91 // Control Sequence Introducer
+    #define TAB    9
+    #define CSI    91 // Control Sequence Introducer, ESC [
+    #define SS3    79 // Single Shift Three, ESC O
     #define UP    65
     #define LEFT  68
     #define RIGHT 67
     #define DOWN  66
 #endif
 
+// Bytes are parsed as they arrive, so sequences split across reads still
+// make one key. A lone ESC is the escape key once EscapeTimeoutMs pass
+// without the rest of a sequence. Parsed keys wait in a queue of
+// KeyQueueSize, input stays unread in stdin rather than being dropped.
+#define EscapeTimeoutMs 25
+#define KeyQueueSize    256
+#define InputChunkSize  4096
+// Longest CSI parameter string kept, longer ones are ignored
+#define CsiParamsSize   16
+
+// The kitty keyboard protocol reports repeats and releases as
+// ESC [ 1 ; modifiers : type final. Terminals without it ignore the request
+// and keysReleaseReported() stays false.
+#define TERM_PushKeyFlags  "\033[>2u" // report event types
+#define TERM_PopKeyFlags   "\033[<u"
+#define TERM_QueryKeyFlags "\033[?u"
+
+void enableKeyReleases();
+bool keyReleasesReported();
 void getChar(Key *key);
+bool getKeyEvent(KeyEvent *event);
+int startInputThread();
+void stopInputThread();
+int getInputFd();
+int getInputQueueDepth();
 void clearInputBuffer();
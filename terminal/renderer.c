@@ -3,16 +3,30 @@
 #include <stdbool.h>
 #include <errno.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
 
 #ifdef _WIN32
     #include <windows.h>
+    #define STDOUT_FILENO 1
 #else
     #include <sys/ioctl.h>
     #include <unistd.h>
+    #include <poll.h>
 #endif
 
-#include "array.h"
 #include "renderer.h"
+#include "trace.h"
+
+
+static char glyphData[MaxGlyphs][UTF8CharacterLength];
+static uint8_t glyphLength[MaxGlyphs];
+static int glyphCount = 128;
+
+// Longest output per cell: cursor move, color code and glyph
+#define MaxCellOutput (sizeof("\033[65535;65535H") + sizeof("\033[97m") + UTF8CharacterLength)
+// Shortest cursor move, to estimate what a span saves
+#define MinMoveOutput (sizeof("\033[1;1H") - 1)
 
 
 const char* get_color_code(Renderer_Color color) {
@@ -66,83 +80,246 @@ int getIndex(const Renderer *r, int x, int y) {
     return y * r->width + x;
 }
 
-void drawAll(const Renderer *r) {
-    for (int y = 0; y < r->height; y++) {
-        for (int x = 0; x < r->width; x++) {
-            int i = getIndex(r, x, y);
-            printf("%s", get_color_code(r->map[i].foreground));
-            printf("%.*s", UTF8CharacterLength, r->map[i].data);
+RendererSink fdSink(int fd) {
+    return (RendererSink){ .type = Sink_Fd, .fd = fd };
+}
+
+RendererSink memorySink() {
+    return (RendererSink){ .type = Sink_Memory, .fd = -1 };
+}
+
+RendererSink nullSink() {
+    return (RendererSink){ .type = Sink_Null, .fd = -1 };
+}
+
+/* Writes the whole buffer, waiting out a non-blocking terminal
+ * @return 0 on success */
+static int writeSink(RendererSink *sink, const char *data, size_t size) {
+    sink->written += size;
+    if (sink->type == Sink_Null) return 0;
+
+    if (sink->type == Sink_Memory) {
+        if (sink->size + size > sink->capacity) {
+            size_t capacity = sink->capacity ? sink->capacity : 1 << 16;
+            while (capacity < sink->size + size) capacity *= 2;
+            char *temp = realloc(sink->data, capacity);
+            if (temp == NULL) return 1;
+            sink->data = temp;
+            sink->capacity = capacity;
         }
+        memcpy(sink->data + sink->size, data, size);
+        sink->size += size;
+        return 0;
+    }
 
-        if (y != r->height - 1) {
-            printf("\n");
+    // Output of printf elsewhere has to reach the terminal first
+    if (sink->fd == STDOUT_FILENO) fflush(stdout);
+    #ifdef _WIN32
+        fwrite(data, 1, size, stdout);
+        sink->syscalls++;
+        return fflush(stdout) != 0;
+    #else
+        while (size) {
+            ssize_t written = write(sink->fd, data, size);
+            sink->syscalls++;
+            if (written == -1) {
+                if (errno == EINTR) continue;
+                // stdin is set O_NONBLOCK by the input module and a tty shares
+                // that flag with stdout, so a full terminal reports EAGAIN
+                if (errno != EAGAIN && errno != EWOULDBLOCK) return 1;
+                struct pollfd pfd = { .fd = sink->fd, .events = POLLOUT };
+                poll(&pfd, 1, -1);
+                sink->syscalls++;
+                continue;
+            }
+            data += written;
+            size -= written;
         }
+        return 0;
+    #endif
+}
+
+static void writeFrame(Renderer *r, const char *data, size_t size) {
+    if (writeSink(&r->sink, data, size) != 0) {
+        // Whatever the terminal received is unknown now
+        r->cursor = -1;
+        r->color = -1;
     }
-    fflush(stdout);
+}
+
+static char *appendNumber(char *out, int value) {
+    char digits[10];
+    int count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (count) *out++ = digits[--count];
+    return out;
+}
+
+static char *appendMove(Renderer *r, char *out, int index) {
+    // Adjacent cells continue the run without a cursor move
+    if (index != r->cursor) {
+        *out++ = '\033';
+        *out++ = '[';
+        out = appendNumber(out, index / r->width + 1);
+        *out++ = ';';
+        out = appendNumber(out, index % r->width + 1);
+        *out++ = 'H';
+    }
+    return out;
+}
+
+/* Appends the output for one front buffer cell, at most MaxCellOutput bytes */
+static char *encodeCell(Renderer *r, char *out, int index) {
+    const Cell *cell = &r->front[index];
+    int x = index % r->width;
+
+    out = appendMove(r, out, index);
+    if (cell->foreground != r->color) {
+        const char *code = get_color_code(cell->foreground);
+        size_t length = strlen(code);
+        memcpy(out, code, length);
+        out += length;
+        r->color = cell->foreground;
+    }
+    // The frame has room for a whole glyph slot after every cell
+    out += getGlyph(cell->glyph, out);
+
+    // The cursor stays on the last column until the next character wraps it
+    r->cursor = x + 1 < r->width ? index + 1 : -1;
+    return out;
+}
+
+void drawAll(Renderer *r) {
+    char *out = r->frame;
+    for (int i = 0; i < r->width * r->height; i++) {
+        out = encodeCell(r, out, i);
+    }
+    writeFrame(r, r->frame, out - r->frame);
 }
 
 int initRenderer(Renderer *r) {
     Size size = getTerminalSize();
-    r->width = size.width;
-    r->height = size.height;
-    if (r->width == -1 || r->height == -1) {
+    if (size.width == -1 || size.height == -1) {
         perror("Error getting terminal size");
         return 1;
     }
+    return initRendererSized(r, size.width, size.height, fdSink(STDOUT_FILENO));
+}
 
-    r->map = calloc(r->width * r->height, sizeof(Character));
-    for (int i = 0; i < r->width * r->height; i++) {
-        r->map[i].data[0] = ' ';
+/* Sets up a renderer without looking at the terminal, for other sinks or
+ * fixed layouts. The sink receives the initial full repaint. */
+int initRendererSized(Renderer *r, int width, int height, RendererSink sink) {
+    if (width <= 0 || height <= 0) {
+        fprintf(stderr, "Error: invalid renderer size %dx%d\n", width, height);
+        return 1;
+    }
+    r->width = width;
+    r->height = height;
+    r->sink = sink;
+    r->capture = NULL;
+
+    int cells = r->width * r->height;
+    r->back = calloc(cells, sizeof(Cell));
+    r->front = calloc(cells, sizeof(Cell));
+    r->rowWritten = calloc(r->height, sizeof(bool));
+    r->changed = malloc(cells * sizeof(int));
+    r->spanAt = calloc(cells, sizeof(RendererSpan*));
+    r->rowSpans = calloc(r->height, sizeof(bool));
+    r->frame = malloc((size_t)cells * MaxCellOutput);
+    if (r->back == NULL || r->front == NULL || r->rowWritten == NULL || r->changed == NULL ||
+        r->spanAt == NULL || r->rowSpans == NULL || r->frame == NULL) {
+        perror("Error allocating renderer");
+        deinitRenderer(r);
+        return 1;
+    }
+    for (int i = 0; i < cells; i++) {
+        r->back[i].glyph = ' ';
+        r->front[i].glyph = ' ';
     }
-    initArray(&r->changed);
+    r->changedCount = 0;
+    r->cursor = -1;
+    r->color = -1;
 
-    setvbuf(stdout, NULL, _IOFBF, BUFSIZ);
     drawAll(r);
-    printf(TERM_HideCursor);
+    writeSink(&r->sink, TERM_HideCursor, strlen(TERM_HideCursor));
 
     return 0;
 }
 
 void deinitRenderer(Renderer *r) {
-    printf("%s", get_color_code(Color_Reset));
-    printf(TERM_ShowCursor);
-    free(r->map);
-    freeArray(&r->changed);
+    stopCapture(r);
+    if (r->frame != NULL) {
+        const char *reset = "\033[0m" TERM_ShowCursor;
+        writeSink(&r->sink, reset, strlen(reset));
+    }
+    free(r->back);
+    free(r->front);
+    free(r->rowWritten);
+    free(r->changed);
+    free(r->spanAt);
+    free(r->rowSpans);
+    free(r->frame);
+    free(r->sink.data);
+    r->frame = NULL;
+    r->sink.data = NULL;
 }
 
 void clear() {
     printf(TERM_CursorTopLeft TERM_ClearAfterCursor);
+    fflush(stdout);
 }
 
 static bool pointInRect(int x, int y, int w, int h) {
     return x >= 0 && x < w && y >= 0 && y < h;
 }
 
-void setChar(Renderer *r, int x, int y, const char *chrNT, Renderer_Color color) {
-    if (!pointInRect(x, y, r->width, r->height)) {
-        fprintf(stderr, "Error: tried to setChar outside renderer box\n");
-        exit(EXIT_FAILURE);
+/* Looks a glyph up in the table, adding it when new. Meant for startup,
+ * the search is linear in the number of glyphs.
+ * @return the glyph id, UnknownGlyph when invalid or the table is full */
+GlyphId internGlyph(const char *chrNT) {
+    size_t length = strlen(chrNT);
+    if (length == 0 || length > UTF8CharacterLength) {
+        fprintf(stderr, "Error: glyph must be 1 to %d bytes\n", UTF8CharacterLength);
+        return UnknownGlyph;
     }
+    if (length == 1 && (unsigned char)chrNT[0] < 128) return chrNT[0];
 
-    if (strlen(chrNT) > UTF8CharacterLength) {
-        printf("Error: utf character too long (max 4 bytes)\n");
-        return;
+    for (int i = 128; i < glyphCount; i++) {
+        if (glyphLength[i] == length && memcmp(glyphData[i], chrNT, length) == 0) return i;
     }
+    if (glyphCount == MaxGlyphs) return UnknownGlyph;
 
-    Character chr = {0};
-    memcpy(chr.data, chrNT, strlen(chrNT));
+    memcpy(glyphData[glyphCount], chrNT, length);
+    glyphLength[glyphCount] = length;
+    return glyphCount++;
+}
 
-    int index = getIndex(r, x, y);
-    if (
-        strcmp(r->map[index].data, chr.data) == 0 &&
-        r->map[index].foreground == color
-    ) return;
-    strncpy(r->map[index].data, chr.data, UTF8CharacterLength);
-    r->map[index].foreground = color;
+/* @return the number of utf-8 bytes written to out */
+int getGlyph(GlyphId glyph, char *out) {
+    if (glyph < 128) {
+        out[0] = glyph;
+        return 1;
+    }
+    memcpy(out, glyphData[glyph], UTF8CharacterLength);
+    return glyphLength[glyph];
+}
 
-    if (!containsArray(&r->changed, index)) {
-        insertArray(&r->changed, index);
+void setCell(Renderer *r, int x, int y, GlyphId glyph, Renderer_Color color) {
+    if (!pointInRect(x, y, r->width, r->height)) {
+        fprintf(stderr, "Error: tried to setChar outside renderer box\n");
+        exit(EXIT_FAILURE);
     }
+
+    // Changes are found by diffing rows in draw()
+    r->back[getIndex(r, x, y)] = (Cell){ .glyph = glyph, .foreground = color };
+    r->rowWritten[y] = true;
+}
+
+void setChar(Renderer *r, int x, int y, const char *chrNT, Renderer_Color color) {
+    setCell(r, x, y, internGlyph(chrNT), color);
 }
 
 static int utf8CharLength(unsigned char c) {
@@ -161,29 +338,280 @@ int setText(Renderer *r, int x, int y, char* text, Renderer_Color color) {
             fprintf(stderr, "Error: Invalid UTF-8\n");
             return 1;
         }
-        CharacterNT chr = {0};
-        memcpy(chr, p, len);
-        chr[len] = '\0';
-        setChar(r, x, y, chr, color);
+        if (len == 1) {
+            setCell(r, x, y, *p, color);
+        } else {
+            CharacterNT chr = {0};
+            memcpy(chr, p, len);
+            setChar(r, x, y, chr, color);
+        }
+
+        p += len;
+        x += 1;
+    }
+
+    return 0;
+}
+
+Viewport getViewport(Renderer *r, int x, int y, int width, int height) {
+    return (Viewport){ .r = r, .x = x, .y = y, .width = width, .height = height };
+}
+
+void setViewportCell(const Viewport *v, int x, int y, GlyphId glyph, Renderer_Color color) {
+    if (!pointInRect(x, y, v->width, v->height)) return;
+    x += v->x;
+    y += v->y;
+    if (!pointInRect(x, y, v->r->width, v->r->height)) return;
+
+    v->r->back[getIndex(v->r, x, y)] = (Cell){ .glyph = glyph, .foreground = color };
+    v->r->rowWritten[y] = true;
+}
+
+/* Text is clipped like cells, invalid UTF-8 ends it */
+void setViewportText(const Viewport *v, int x, int y, const char *text, Renderer_Color color) {
+    const unsigned char *p = (const unsigned char*)text;
+    while (*p) {
+        int len = utf8CharLength(*p);
+        if (len < 0) return;
+
+        GlyphId glyph = *p;
+        if (len > 1) {
+            CharacterNT chr = {0};
+            memcpy(chr, p, len);
+            glyph = internGlyph(chr);
+        }
+        setViewportCell(v, x, y, glyph, color);
 
         p += len;
         x += 1;
     }
+}
+
+/* Encodes the output of a run of cells once, the span can then be drawn any
+ * number of times without encoding it again
+ * @return 0 on success, 1 when wider than MaxSpanWidth */
+int initSpan(RendererSpan *span, const Cell *cells, int width) {
+    if (width <= 0 || width > MaxSpanWidth) {
+        fprintf(stderr, "Error: span must be 1 to %d cells\n", MaxSpanWidth);
+        return 1;
+    }
+    span->width = width;
+    memcpy(span->cells, cells, width * sizeof(Cell));
+
+    char *out = span->output;
+    int color = -1;
+    for (int i = 0; i < width; i++) {
+        if (cells[i].foreground != color) {
+            const char *code = get_color_code(cells[i].foreground);
+            size_t length = strlen(code);
+            memcpy(out, code, length);
+            out += length;
+            if (color == -1) span->colorLength = length;
+            color = cells[i].foreground;
+        }
+        out += getGlyph(cells[i].glyph, out);
+    }
+    span->endColor = color;
+    span->length = out - span->output;
+    return 0;
+}
+
+/* Copies a span into the back buffer with one memcpy. Spans that do not fit
+ * whole are set cell by cell. The span must stay valid until the next draw. */
+void setViewportSpan(const Viewport *v, int x, int y, const RendererSpan *span) {
+    int screenX = v->x + x;
+    int screenY = v->y + y;
+    Renderer *r = v->r;
+    if (x < 0 || x + span->width > v->width || y < 0 || y >= v->height ||
+        screenX < 0 || screenX + span->width > r->width || screenY < 0 || screenY >= r->height) {
+        for (int i = 0; i < span->width; i++) {
+            setViewportCell(v, x + i, y, span->cells[i].glyph, span->cells[i].foreground);
+        }
+        return;
+    }
+
+    int index = getIndex(r, screenX, screenY);
+    memcpy(r->back + index, span->cells, span->width * sizeof(Cell));
+    r->spanAt[index] = span;
+    r->rowWritten[screenY] = true;
+    r->rowSpans[screenY] = true;
+}
+
+double getWallTime() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void captureVarint(FILE *file, uint32_t value) {
+    while (value >= 0x80) {
+        putc((value & 0x7F) | 0x80, file);
+        value >>= 7;
+    }
+    putc(value, file);
+}
+
+static void captureCell(FILE *file, const Cell *cell, int index, int *previous) {
+    int gap = index - *previous - 1;
+    *previous = index;
+    captureVarint(file, gap >= 0 ? (uint32_t)gap << 1 : ((uint32_t)(-gap - 1) << 1) | 1);
+
+    char glyph[UTF8CharacterLength];
+    int length = getGlyph(cell->glyph, glyph);
+    putc(cell->foreground << 3 | length, file);
+    fwrite(glyph, 1, length, file);
+}
+
+/* Captures the changed cells, or every cell when all is set */
+static void captureFrame(Renderer *r, bool all) {
+    double now = getWallTime();
+    uint32_t deltaMs = (now - r->captureTime) * 1000;
+    // Keep the rounding error from accumulating
+    r->captureTime += deltaMs / 1000.0;
+
+    captureVarint(r->capture, deltaMs);
+    int previous = -1;
+    if (all) {
+        captureVarint(r->capture, r->width * r->height);
+        for (int index = 0; index < r->width * r->height; index++) {
+            captureCell(r->capture, &r->front[index], index, &previous);
+        }
+        return;
+    }
+
+    captureVarint(r->capture, r->changedCount);
+    for (int i = 0; i < r->changedCount; i++) {
+        int index = r->changed[i];
+        captureCell(r->capture, &r->front[index], index, &previous);
+    }
+}
+
+int startCapture(Renderer *r, const char *path) {
+    r->capture = fopen(path, "wb");
+    if (r->capture == NULL) {
+        perror("Error opening capture file");
+        return 1;
+    }
+    setvbuf(r->capture, NULL, _IOFBF, 1 << 16);
 
+    fwrite(CaptureMagic, 1, 4, r->capture);
+    putc(CaptureVersion, r->capture);
+    captureVarint(r->capture, r->width);
+    captureVarint(r->capture, r->height);
+
+    r->captureTime = getWallTime();
+    captureFrame(r, true);
     return 0;
 }
 
+void stopCapture(Renderer *r) {
+    if (r->capture == NULL) return;
+    if (fclose(r->capture) != 0) {
+        perror("Error writing capture file");
+    }
+    r->capture = NULL;
+}
+
+/* Diffs the written rows of the back buffer against the front buffer,
+ * lists the changed cells and copies those rows to the front */
+static void diffBuffers(Renderer *r) {
+    r->changedCount = 0;
+    for (int y = 0; y < r->height; y++) {
+        if (!r->rowWritten[y]) continue;
+        r->rowWritten[y] = false;
+
+        int start = y * r->width;
+        Cell *back = r->back + start;
+        Cell *front = r->front + start;
+        if (memcmp(back, front, r->width * sizeof(Cell)) == 0) continue;
+
+        for (int x = 0; x < r->width; x++) {
+            uint32_t a, b;
+            memcpy(&a, &back[x], sizeof(a));
+            memcpy(&b, &front[x], sizeof(b));
+            if (a != b) r->changed[r->changedCount++] = start + x;
+        }
+        memcpy(front, back, r->width * sizeof(Cell));
+    }
+}
+
+/* Emits the span covering changed cell i as its cached output, when that is
+ * no longer than encoding its changed cells one by one
+ * @return the number of changed cells covered, 0 when not used */
+static int encodeSpan(Renderer *r, char **out, int i) {
+    int index = r->changed[i];
+    int rowStart = index - index % r->width;
+    int start = index;
+    const RendererSpan *span = NULL;
+    while (start >= rowStart && start > index - MaxSpanWidth) {
+        span = r->spanAt[start];
+        if (span != NULL) break;
+        start--;
+    }
+    if (span == NULL || index >= start + span->width) return 0;
+    // Cells written over the span after it was set
+    if (memcmp(r->front + start, span->cells, span->width * sizeof(Cell)) != 0) return 0;
+
+    // Per cell output would be the glyphs plus a cursor move per run
+    int end = start + span->width;
+    int count = 0;
+    int moves = 0;
+    for (int j = i; j < r->changedCount && r->changed[j] < end; j++) {
+        int expected = j == i ? r->cursor : r->changed[j - 1] + 1;
+        if (r->changed[j] != expected) moves++;
+        count++;
+    }
+    // A lone cell is never worth the span, which also keeps the output within
+    // the MaxCellOutput per changed cell the frame is sized for
+    if (count < 2) return 0;
+    if (span->length > count * span->length / span->width + moves * (int)MinMoveOutput) return 0;
+
+    char *p = appendMove(r, *out, start);
+    int skip = span->cells[0].foreground == r->color ? span->colorLength : 0;
+    memcpy(p, span->output + skip, span->length - skip);
+    *out = p + span->length - skip;
+
+    r->color = span->endColor;
+    r->cursor = end % r->width != 0 ? end : -1;
+    return count;
+}
+
+static void clearSpans(Renderer *r) {
+    for (int y = 0; y < r->height; y++) {
+        if (!r->rowSpans[y]) continue;
+        r->rowSpans[y] = false;
+        memset(r->spanAt + y * r->width, 0, r->width * sizeof(RendererSpan*));
+    }
+}
+
 void draw(Renderer *r) {
-    if (r->changed.count == 0) return;
+    TRACE_BEGIN("encode");
+    diffBuffers(r);
+    if (r->changedCount == 0) {
+        clearSpans(r);
+        TRACE_END("encode");
+        return;
+    }
 
-    for (int i = 0; i < r->changed.count; i++) {
-        int index = r->changed.data[i];
-        int x = index % r->width;
-        int y = index / r->width;
-        printf(TERM_MoveCursor, y + 1, x + 1);
-        printf("%s", get_color_code(r->map[index].foreground));
-        printf("%.*s", UTF8CharacterLength, r->map[index].data);
+    if (r->capture != NULL) {
+        captureFrame(r, false);
     }
-    r->changed.count = 0;
-    fflush(stdout);
+
+    char *out = r->frame;
+    for (int i = 0; i < r->changedCount;) {
+        int index = r->changed[i];
+        int covered = r->rowSpans[index / r->width] ? encodeSpan(r, &out, i) : 0;
+        if (covered) {
+            i += covered;
+        } else {
+            out = encodeCell(r, out, index);
+            i++;
+        }
+    }
+    clearSpans(r);
+    TRACE_END("encode");
+
+    TRACE_BEGIN("flush");
+    writeFrame(r, r->frame, out - r->frame);
+    TRACE_END("flush");
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #ifdef _WIN32
     #include <windows.h>
 #else
@@ -8,8 +10,6 @@
     #include <unistd.h>
 #endif
 
-#include "array.h"
-
 
 typedef struct {
     int width;
@@ -47,24 +47,109 @@ const char* get_color_code(Renderer_Color color);
 #define UTF8CharacterLength 4
 typedef char CharacterNT[UTF8CharacterLength + 1]; // Null terminated utf-8 character
 
+// Glyphs are interned once and cells refer to them by id. Ids below 128 are
+// the ASCII character itself, the rest index a table shared by all renderers.
+typedef uint16_t GlyphId;
+#define MaxGlyphs    1024
+#define UnknownGlyph '?'
+
+// Packed into 4 bytes so cells compare as one word
+typedef struct {
+    GlyphId glyph;
+    uint8_t foreground; // Renderer_Color
+    uint8_t unused;     // always 0
+} Cell;
+_Static_assert(sizeof(Cell) == 4, "Cell must pack into 4 bytes");
+
+// Session capture, written by draw() while recording:
+//   "TRCP" version:u8 width:varint height:varint
+//   frames: deltaMs:varint cells:varint, then per cell
+//     zigzag(index - previous index - 1):varint, color << 3 | length:u8, utf-8 bytes
+// The first frame holds every cell of the screen.
+#define CaptureMagic   "TRCP"
+#define CaptureVersion 1
+
+// Where encoded frames go: a file descriptor (the terminal), a growing memory
+// buffer, or nowhere. Every sink counts the bytes it was handed.
+typedef enum {
+    Sink_Fd,
+    Sink_Memory,
+    Sink_Null
+} SinkType;
+
 typedef struct {
-    char data[UTF8CharacterLength];
-    Renderer_Color foreground;
-} Character;
+    SinkType type;
+    int fd;
+    char *data;      // memory sink contents, the owner resets size as needed
+    size_t size;
+    size_t capacity;
+    size_t written;  // total bytes, for every sink type
+    size_t syscalls; // write and poll calls of an fd sink
+} RendererSink;
+
+// A run of cells on one row with its terminal output encoded up front, for
+// content drawn over and over such as board rows. The output starts with the
+// color code of the first cell and has further codes only where colors change.
+#define MaxSpanWidth 16
+typedef struct {
+    int width;
+    Cell cells[MaxSpanWidth];
+    int colorLength;  // bytes of the leading color code
+    uint8_t endColor; // color the terminal is left in
+    int length;
+    char output[MaxSpanWidth * (sizeof("\033[97m") - 1 + UTF8CharacterLength)];
+} RendererSpan;
 
 typedef struct {
     int width;
     int height;
-    Character *map;
-    IntArray changed;
+    RendererSink sink;
+    Cell *back;       // written by setCell
+    Cell *front;      // what the terminal shows
+    bool *rowWritten; // rows setChar touched since the last draw
+    int *changed;     // cells found by the last diff
+    int changedCount;
+    const RendererSpan **spanAt; // spans set since the last draw, by first cell
+    bool *rowSpans;              // rows with an entry in spanAt
+    char *frame;      // output of one draw(), sized for a full repaint
+    int cursor;       // cell index the terminal cursor is on, -1 if unknown
+    int color;        // last color sent to the terminal, -1 if unknown
+    FILE *capture;
+    double captureTime; // seconds, of the last captured frame
 } Renderer;
 
 
+// A sub-rectangle of the screen with its own origin, writes outside of it or
+// off screen are dropped
+typedef struct {
+    Renderer *r;
+    int x;
+    int y;
+    int width;
+    int height;
+} Viewport;
+
+
 int getIndex(const Renderer *r, int x, int y);
-void drawAll(const Renderer *r);
+void drawAll(Renderer *r);
 int initRenderer(Renderer *r);
+int initRendererSized(Renderer *r, int width, int height, RendererSink sink);
+RendererSink fdSink(int fd);
+RendererSink memorySink();
+RendererSink nullSink();
 void deinitRenderer(Renderer *r);
 void clear();
+GlyphId internGlyph(const char *chrNT);
+int getGlyph(GlyphId glyph, char *out);
+void setCell(Renderer *r, int x, int y, GlyphId glyph, Renderer_Color color);
 void setChar(Renderer *r, int x, int y, const char *chrNT, Renderer_Color color);
 int setText(Renderer *r, int x, int y, char* text, Renderer_Color color);
+Viewport getViewport(Renderer *r, int x, int y, int width, int height);
+void setViewportCell(const Viewport *v, int x, int y, GlyphId glyph, Renderer_Color color);
+void setViewportText(const Viewport *v, int x, int y, const char *text, Renderer_Color color);
+int initSpan(RendererSpan *span, const Cell *cells, int width);
+void setViewportSpan(const Viewport *v, int x, int y, const RendererSpan *span);
 void draw(Renderer *r);
+int startCapture(Renderer *r, const char *path);
+void stopCapture(Renderer *r);
+double getWallTime();
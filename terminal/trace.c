@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "trace.h"
+#include "events.h"
+
+
+typedef struct TraceRing {
+    struct TraceRing *next;
+    const char *thread;
+    int id;
+    uint64_t count; // events ever recorded, the ring holds the last ones
+    TraceEvent events[TraceRingSize];
+} TraceRing;
+
+// Rings of every thread that traced, pushed on first use and never freed so
+// they can be written after their threads are gone
+static _Atomic(TraceRing *) rings;
+static atomic_int ringCount;
+static _Thread_local TraceRing *ring;
+
+static TraceRing *getRing() {
+    if (ring != NULL) return ring;
+    ring = calloc(1, sizeof(TraceRing));
+    if (ring == NULL) return NULL;
+    ring->id = atomic_fetch_add(&ringCount, 1) + 1;
+    ring->next = atomic_load(&rings);
+    while (!atomic_compare_exchange_weak(&rings, &ring->next, ring));
+    return ring;
+}
+
+void traceEvent(const char *name, char phase) {
+    TraceRing *r = getRing();
+    if (r == NULL) return;
+    r->events[r->count % TraceRingSize] = (TraceEvent){ name, monotonicUs(), phase };
+    r->count++;
+}
+
+void traceThread(const char *name) {
+    TraceRing *r = getRing();
+    if (r != NULL) r->thread = name;
+}
+
+static void writeRing(FILE *file, const TraceRing *r, uint64_t start, bool *first) {
+    if (r->thread != NULL) {
+        fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            *first ? "" : ",", r->id, r->thread);
+        *first = false;
+    }
+
+    uint64_t begin = r->count > TraceRingSize ? r->count - TraceRingSize : 0;
+    int depth = 0;
+    for (uint64_t i = begin; i < r->count; i++) {
+        const TraceEvent *e = &r->events[i % TraceRingSize];
+        // Ends whose begin was overwritten would close nothing
+        if (e->phase == 'E') {
+            if (depth == 0) continue;
+            depth--;
+        } else {
+            depth++;
+        }
+        fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":1,\"tid\":%d}",
+            *first ? "" : ",", e->name, e->phase, (unsigned long long)(e->timeUs - start), r->id);
+        *first = false;
+    }
+}
+
+/* Writes the events of every thread in Chrome trace event JSON. Threads
+ * still tracing at the time may tear their last events, call it on exit.
+ * @return 0 on success */
+int writeTrace(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror("Error opening trace file");
+        return 1;
+    }
+
+    // Times from the oldest event kept, the viewer starts at 0
+    uint64_t start = UINT64_MAX;
+    for (TraceRing *r = atomic_load(&rings); r != NULL; r = r->next) {
+        if (r->count == 0) continue;
+        uint64_t oldest = r->count > TraceRingSize ? r->count % TraceRingSize : 0;
+        if (r->events[oldest].timeUs < start) start = r->events[oldest].timeUs;
+    }
+    if (start == UINT64_MAX) start = 0;
+
+    bool first = true;
+    fprintf(file, "{\"traceEvents\":[");
+    for (TraceRing *r = atomic_load(&rings); r != NULL; r = r->next) {
+        writeRing(file, r, start, &first);
+    }
+    fprintf(file, "\n]}\n");
+
+    if (fclose(file) != 0) {
+        perror("Error writing trace file");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+
+// Begin and end times of named phases, kept in a ring per thread and written
+// as Chrome trace events (chrome://tracing, ui.perfetto.dev). Built only with
+// USE_TRACE, `make TRACE=1`; otherwise the macros are empty and cost nothing.
+// Names must be string literals, only the pointer is stored.
+#ifdef USE_TRACE
+    #define TRACE_BEGIN(name)  traceEvent(name, 'B')
+    #define TRACE_END(name)    traceEvent(name, 'E')
+    #define TRACE_THREAD(name) traceThread(name)
+    #define TRACE_WRITE(path)  writeTrace(path)
+#else
+    #define TRACE_BEGIN(name)  ((void)0)
+    #define TRACE_END(name)    ((void)0)
+    #define TRACE_THREAD(name) ((void)0)
+    #define TRACE_WRITE(path)  ((void)0)
+#endif
+
+// Where the programs write their trace on exit
+#define TracePath "trace.json"
+// Events per thread, older ones are overwritten
+#define TraceRingSize 65536
+
+typedef struct {
+    const char *name;
+    uint64_t timeUs; // monotonicUs()
+    char phase;      // 'B' or 'E'
+} TraceEvent;
+
+void traceEvent(const char *name, char phase);
+void traceThread(const char *name);
+int writeTrace(const char *path);
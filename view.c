@@ -0,0 +1,164 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "game.h"
+#include "display.h"
+#include "terminal/renderer.h"
+#include "view.h"
+
+
+// https://en.wikipedia.org/wiki/List_of_Unicode_characters#Box_Drawing
+static const CharacterNT C_Hash = "▒"; // 	█ ▓ ▒ ░
+static const CharacterNT C_Space = " ";
+static const CharacterNT C_Pipe = "│";
+static const CharacterNT C_Dash = "─";
+static const CharacterNT C_BoxTL = "┌";
+static const CharacterNT C_BoxTR = "┐";
+static const CharacterNT C_BoxBL = "└";
+static const CharacterNT C_BoxBR = "┘";
+
+// Interned on first use, drawing only copies ids
+static GlyphId G_Hash, G_Space, G_Pipe, G_Dash, G_BoxTL, G_BoxTR, G_BoxBL, G_BoxBR;
+static bool glyphsInterned = false;
+
+// Indexed by DrawStyle
+static const Renderer_Color StyleColor[] = {
+    Color_Red,
+    Color_Green,
+    Color_Yellow,
+    Color_Blue,
+    Color_Magenta,
+    Color_Cyan,
+    Color_White,
+    [Style_Locked]   = Color_Bright_Black,
+    [Style_Empty]    = Color_Bright_Black,
+    [Style_Box]      = Color_White,
+    [Style_Text]     = Color_White,
+    [Style_Score]    = Color_Bright_White,
+    [Style_GameOver] = Color_Bright_Red
+};
+
+// Board rows by style and occupancy mask, encoded on first use
+_Static_assert(GAME_WIDTH <= MaxSpanWidth, "board rows must fit a span");
+static RendererSpan *rowCache[Style_Count];
+
+static void internGlyphs() {
+    G_Hash  = internGlyph(C_Hash);
+    G_Space = internGlyph(C_Space);
+    G_Pipe  = internGlyph(C_Pipe);
+    G_Dash  = internGlyph(C_Dash);
+    G_BoxTL = internGlyph(C_BoxTL);
+    G_BoxTR = internGlyph(C_BoxTR);
+    G_BoxBL = internGlyph(C_BoxBL);
+    G_BoxBR = internGlyph(C_BoxBR);
+    glyphsInterned = true;
+}
+
+/* @return the cached span of a board row, NULL if the cache can not be allocated */
+static const RendererSpan *getRowSpan(DrawStyle style, uint16_t mask) {
+    if (rowCache[style] == NULL) {
+        rowCache[style] = calloc(1 << GAME_WIDTH, sizeof(RendererSpan));
+        if (rowCache[style] == NULL) return NULL;
+    }
+    RendererSpan *span = &rowCache[style][mask & ((1 << GAME_WIDTH) - 1)];
+    if (span->width == 0) {
+        Cell cells[GAME_WIDTH];
+        for (int x = 0; x < GAME_WIDTH; x++) {
+            cells[x] = (Cell){ .glyph = (mask >> x) & 1 ? G_Hash : G_Space, .foreground = StyleColor[style] };
+        }
+        initSpan(span, cells, GAME_WIDTH);
+    }
+    return span;
+}
+
+static void drawRow(const Viewport *v, const DrawCommand *c) {
+    const RendererSpan *span = c->b == GAME_WIDTH ? getRowSpan(c->style, c->a) : NULL;
+    if (span != NULL) {
+        setViewportSpan(v, c->x, c->y, span);
+        return;
+    }
+    Renderer_Color color = StyleColor[c->style];
+    for (int x = 0; x < c->b; x++) {
+        setViewportCell(v, c->x + x, c->y, (c->a >> x) & 1 ? G_Hash : G_Space, color);
+    }
+}
+
+// Outline drawn on the tiles around the inner rectangle
+static void drawBox(const Viewport *v, int x, int y, int width, int height, Renderer_Color color) {
+    int left = x - 1, right = x + width;
+    int top = y - 1, bottom = y + height;
+    for (int i = y; i < bottom; i++) {
+        setViewportCell(v, left , i, G_Pipe, color);
+        setViewportCell(v, right, i, G_Pipe, color);
+    }
+    for (int i = x; i < right; i++) {
+        setViewportCell(v, i, top   , G_Dash, color);
+        setViewportCell(v, i, bottom, G_Dash, color);
+    }
+
+    setViewportCell(v, left , top   , G_BoxTL, color);
+    setViewportCell(v, right, top   , G_BoxTR, color);
+    setViewportCell(v, left , bottom, G_BoxBL, color);
+    setViewportCell(v, right, bottom, G_BoxBR, color);
+}
+
+void drawDisplayList(const Viewport *v, const DisplayList *list) {
+    if (!glyphsInterned) internGlyphs();
+
+    for (int i = 0; i < list->count; i++) {
+        const DrawCommand *c = &list->commands[i];
+        Renderer_Color color = StyleColor[c->style];
+        switch (c->type) {
+            case Draw_Cell:
+                setViewportCell(v, c->x, c->y, G_Hash, color);
+                break;
+            case Draw_Row:
+                drawRow(v, c);
+                break;
+            case Draw_Box:
+                drawBox(v, c->x, c->y, c->a, c->b, color);
+                break;
+            case Draw_Clear:
+                for (int y = 0; y < c->b; y++) {
+                    for (int x = 0; x < c->a; x++) {
+                        setViewportCell(v, c->x + x, c->y + y, G_Space, Color_Reset);
+                    }
+                }
+                break;
+            case Draw_Text: {
+                char text[DisplayListTextSize + 1];
+                memcpy(text, list->text + c->a, c->b);
+                text[c->b] = '\0';
+                setViewportText(v, c->x, c->y, text, color);
+                break;
+            }
+        }
+    }
+}
+
+void drawGame(Renderer *r, const GameState *state) {
+    drawGameAt(r, state, (r->width - GAME_WIDTH) / 2, (r->height - GAME_HEIGHT) / 2);
+}
+
+// gameX, gameY: top left tile of the board, the box is drawn around it
+void drawGameAt(Renderer *r, const GameState *state, int gameX, int gameY) {
+    Viewport v = getViewport(r, gameX - SceneBoardX, gameY - SceneBoardY, ViewGameWidth, ViewBoardHeight);
+    drawGameIn(&v, state);
+}
+
+// The board with its box at the viewport origin
+void drawBoard(const Viewport *v, const GameState *state) {
+    DisplayList list;
+    initDisplayList(&list);
+    buildBoardScene(&list, state);
+    drawDisplayList(v, &list);
+}
+
+// The board and the next piece box right of it
+void drawGameIn(const Viewport *v, const GameState *state) {
+    DisplayList list;
+    initDisplayList(&list);
+    buildGameScene(&list, state);
+    drawDisplayList(v, &list);
+}
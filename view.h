@@ -0,0 +1,19 @@
+#pragma once
+
+#include "game.h"
+#include "display.h"
+#include "terminal/renderer.h"
+
+
+// Columns used right of the board for the next piece box
+#define ViewSideWidth 10
+// Board including its box, and board plus next piece box
+#define ViewBoardWidth  (GAME_WIDTH + 2)
+#define ViewBoardHeight (GAME_HEIGHT + 2)
+#define ViewGameWidth   (ViewBoardWidth + ViewSideWidth)
+
+void drawGame(Renderer *r, const GameState *state);
+void drawGameAt(Renderer *r, const GameState *state, int gameX, int gameY);
+void drawGameIn(const Viewport *v, const GameState *state);
+void drawBoard(const Viewport *v, const GameState *state);
+void drawDisplayList(const Viewport *v, const DisplayList *list);